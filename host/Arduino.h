@@ -0,0 +1,41 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+/*
+Sustituto en Linux del subconjunto del núcleo Arduino-ESP32 que usa el proyecto.
+micros() y millis() se basan en el reloj monótono de POSIX y Serial escribe en
+la salida estándar. main() está en main_posix.cpp y llama a setup() y a loop()
+como el núcleo Arduino; esp_deep_sleep_start() termina el proceso.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+// En Linux no hay memoria flash aparte
+#define PROGMEM
+
+unsigned long micros();
+unsigned long millis();
+void delay(uint32_t ms);
+// Termina el proceso, que es lo que equivale a dormir al ESP32 hasta el siguiente reinicio
+[[noreturn]] void esp_deep_sleep_start();
+
+class HardwareSerial
+{
+public:
+  void begin(unsigned long baudrate);
+  int printf(const char *formato, ...) __attribute__((format(printf, 2, 3)));
+  size_t print(const char *texto);
+  size_t println(const char *texto = "");
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,64 @@
+// Implementación en Linux del subconjunto del núcleo Arduino que usa el proyecto
+
+#include "Arduino.h"
+
+#include <stdarg.h>
+#include <time.h>
+
+HardwareSerial Serial;
+
+static uint64_t nanosegundosMonotonicos()
+{
+  struct timespec instante;
+  clock_gettime(CLOCK_MONOTONIC, &instante);
+  return (uint64_t)instante.tv_sec * 1000000000ULL + instante.tv_nsec;
+}
+
+static const uint64_t instanteArranque = nanosegundosMonotonicos();
+
+unsigned long micros()
+{
+  return (unsigned long)((nanosegundosMonotonicos() - instanteArranque) / 1000);
+}
+
+unsigned long millis()
+{
+  return (unsigned long)((nanosegundosMonotonicos() - instanteArranque) / 1000000);
+}
+
+void delay(uint32_t ms)
+{
+  vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+void esp_deep_sleep_start()
+{
+  fflush(stdout);
+  exit(0);
+}
+
+void HardwareSerial::begin(unsigned long baudrate)
+{
+  setvbuf(stdout, NULL, _IOLBF, 0); // Salida por líneas, como el monitor serie
+}
+
+int HardwareSerial::printf(const char *formato, ...)
+{
+  va_list argumentos;
+  va_start(argumentos, formato);
+  int escritos = vprintf(formato, argumentos);
+  va_end(argumentos);
+  return escritos;
+}
+
+size_t HardwareSerial::print(const char *texto)
+{
+  return fputs(texto, stdout) < 0 ? 0 : strlen(texto);
+}
+
+size_t HardwareSerial::println(const char *texto)
+{
+  size_t escritos = print(texto);
+  fputc('\n', stdout);
+  return escritos + 1;
+}
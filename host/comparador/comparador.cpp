@@ -0,0 +1,352 @@
+/*
+Comparador de resultados del benchmark, para ejecutar en el ordenador.
+
+Uso:
+  comparador [--umbral porcentaje] [--alfa nivel] referencia.txt ejecucion.txt [ejecucion.txt ...]
+
+Cada fichero es la salida del puerto serie (o del entorno native) de una
+ejecución. Se leen dos formatos:
+- Líneas CSV del resumen (SALIDA_CSV, ver include/HistogramaLatencia.h), con
+  número de muestras, media y desviación típica de cada esquema y magnitud
+- El formato original, como ResultadosEjecución.txt: una línea con los tiempos
+  de cada iteración en us seguida de "La media del envío de datos ... ha sido"
+
+Las ejecuciones se juntan en una sola muestra por esquema y magnitud. Para
+cada una se muestra la media con su intervalo de confianza, el cambio respecto
+a la referencia y el p-valor de la prueba t de Welch. Un cambio es significativo
+si p < alfa (0.05 por defecto) y además supera el umbral (1 % por defecto), para
+no marcar diferencias reales pero irrelevantes con muchas muestras. Si hay
+alguna regresión significativa el programa termina con código 1.
+*/
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Momentos de una muestra, que se pueden juntar sin guardar las muestras
+struct Momentos
+{
+  uint64_t muestras = 0;
+  double media = 0;
+  double sumaM2 = 0; // Suma de los cuadrados de las diferencias con la media
+};
+
+// Junta dos muestras (Chan et al.)
+static void juntarMomentos(Momentos &total, const Momentos &parte)
+{
+  if (parte.muestras == 0)
+  {
+    return;
+  }
+  uint64_t muestras = total.muestras + parte.muestras;
+  double diferencia = parte.media - total.media;
+  total.sumaM2 += parte.sumaM2 + diferencia * diferencia * total.muestras * parte.muestras / muestras;
+  total.media += diferencia * parte.muestras / muestras;
+  total.muestras = muestras;
+}
+
+static double varianza(const Momentos &m)
+{
+  return m.muestras > 1 ? m.sumaM2 / (m.muestras - 1) : 0.0;
+}
+
+// Fracción continua de la beta incompleta (método de Lentz)
+static double fraccionBeta(double a, double b, double x)
+{
+  const double PEQUENO = 1e-300;
+  double c = 1.0;
+  double d = 1.0 - (a + b) * x / (a + 1.0);
+  d = fabs(d) < PEQUENO ? PEQUENO : d;
+  d = 1.0 / d;
+  double resultado = d;
+  for (int m = 1; m <= 300; m++)
+  {
+    int m2 = 2 * m;
+    double coeficiente = m * (b - m) * x / ((a + m2 - 1.0) * (a + m2));
+    d = 1.0 + coeficiente * d;
+    d = fabs(d) < PEQUENO ? PEQUENO : d;
+    c = 1.0 + coeficiente / c;
+    c = fabs(c) < PEQUENO ? PEQUENO : c;
+    d = 1.0 / d;
+    resultado *= d * c;
+    coeficiente = -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1.0));
+    d = 1.0 + coeficiente * d;
+    d = fabs(d) < PEQUENO ? PEQUENO : d;
+    c = 1.0 + coeficiente / c;
+    c = fabs(c) < PEQUENO ? PEQUENO : c;
+    d = 1.0 / d;
+    double paso = d * c;
+    resultado *= paso;
+    if (fabs(paso - 1.0) < 1e-12)
+    {
+      break;
+    }
+  }
+  return resultado;
+}
+
+// Beta incompleta regularizada I_x(a, b)
+static double betaIncompleta(double a, double b, double x)
+{
+  if (x <= 0.0)
+  {
+    return 0.0;
+  }
+  if (x >= 1.0)
+  {
+    return 1.0;
+  }
+  double factor = exp(lgamma(a + b) - lgamma(a) - lgamma(b) + a * log(x) + b * log(1.0 - x));
+  if (x < (a + 1.0) / (a + b + 2.0))
+  {
+    return factor * fraccionBeta(a, b, x) / a;
+  }
+  return 1.0 - factor * fraccionBeta(b, a, 1.0 - x) / b;
+}
+
+// Probabilidad de que |T| >= t con una t de Student de los grados de libertad indicados
+static double pValorT(double t, double grados)
+{
+  return betaIncompleta(grados / 2.0, 0.5, grados / (grados + t * t));
+}
+
+// Valor t tal que P(|T| >= t) = alfa, por bisección
+static double tCritico(double alfa, double grados)
+{
+  double inferior = 0.0;
+  double superior = 1000.0;
+  for (int i = 0; i < 100; i++)
+  {
+    double medio = (inferior + superior) / 2.0;
+    if (pValorT(medio, grados) > alfa)
+    {
+      inferior = medio;
+    }
+    else
+    {
+      superior = medio;
+    }
+  }
+  return (inferior + superior) / 2.0;
+}
+
+// Semiancho del intervalo de confianza de la media
+static double intervaloConfianza(const Momentos &m, double alfa)
+{
+  if (m.muestras < 2)
+  {
+    return 0.0;
+  }
+  return tCritico(alfa, m.muestras - 1) * sqrt(varianza(m) / m.muestras);
+}
+
+// Resultados de un conjunto de ejecuciones: rol|esquema|magnitud -> momentos
+typedef std::map<std::string, Momentos> Resultados;
+
+static std::string formarClave(const std::string &rol, const std::string &esquema, const std::string &magnitud)
+{
+  return rol + "|" + esquema + "|" + magnitud;
+}
+
+// Nombre del esquema a partir de la descripción del formato original ("cifrados con AES-128" -> "AES-128")
+static std::string nombreDesdeDescripcion(const std::string &descripcion)
+{
+  size_t posicion = descripcion.rfind(" con ");
+  return posicion == std::string::npos ? descripcion : descripcion.substr(posicion + 5);
+}
+
+static std::vector<std::string> separarCampos(const std::string &linea, char separador)
+{
+  std::vector<std::string> campos;
+  std::stringstream flujo(linea);
+  std::string campo;
+  while (std::getline(flujo, campo, separador))
+  {
+    campos.push_back(campo);
+  }
+  return campos;
+}
+
+// Si la línea sólo tiene números, los deja en muestras
+static bool leerLineaMuestras(const std::string &linea, std::vector<double> &muestras)
+{
+  std::stringstream flujo(linea);
+  std::string numero;
+  std::vector<double> leidas;
+  while (flujo >> numero)
+  {
+    char *fin;
+    double valor = strtod(numero.c_str(), &fin);
+    if (*fin != '\0')
+    {
+      return false;
+    }
+    leidas.push_back(valor);
+  }
+  if (leidas.empty())
+  {
+    return false;
+  }
+  muestras = leidas;
+  return true;
+}
+
+static bool leerFichero(const char *ruta, Resultados &resultados)
+{
+  std::ifstream fichero(ruta);
+  if (!fichero)
+  {
+    fprintf(stderr, "No se puede abrir %s\n", ruta);
+    return false;
+  }
+  const std::string MEDIA_ORIGINAL = "La media del envío de datos ";
+  const std::string FIN_MEDIA_ORIGINAL = " ha sido:";
+  std::vector<double> muestrasPendientes;
+  std::string linea;
+  while (std::getline(fichero, linea))
+  {
+    if (!linea.empty() && linea.back() == '\r')
+    {
+      linea.pop_back();
+    }
+    // Formato CSV: puede venir detrás de una marca de tiempo del monitor
+    size_t inicioCSV = linea.find("CSV,latencia,");
+    if (inicioCSV != std::string::npos)
+    {
+      std::vector<std::string> campos = separarCampos(linea.substr(inicioCSV), ',');
+      if (campos.size() < 9)
+      {
+        continue;
+      }
+      Momentos m;
+      m.muestras = strtoull(campos[5].c_str(), NULL, 10);
+      m.media = strtod(campos[7].c_str(), NULL);
+      double desviacion = strtod(campos[8].c_str(), NULL);
+      m.sumaM2 = m.muestras > 1 ? desviacion * desviacion * (m.muestras - 1) : 0.0;
+      juntarMomentos(resultados[formarClave(campos[2], campos[3], campos[4])], m);
+      continue;
+    }
+    // Formato original: línea de muestras y después la línea de la media
+    if (leerLineaMuestras(linea, muestrasPendientes))
+    {
+      continue;
+    }
+    size_t inicioMedia = linea.find(MEDIA_ORIGINAL);
+    size_t finMedia = linea.find(FIN_MEDIA_ORIGINAL);
+    if (inicioMedia != std::string::npos && finMedia != std::string::npos && !muestrasPendientes.empty())
+    {
+      size_t inicioDescripcion = inicioMedia + MEDIA_ORIGINAL.size();
+      std::string esquema = nombreDesdeDescripcion(linea.substr(inicioDescripcion, finMedia - inicioDescripcion));
+      Momentos m;
+      for (double muestra : muestrasPendientes)
+      {
+        Momentos una;
+        una.muestras = 1;
+        una.media = muestra;
+        juntarMomentos(m, una);
+      }
+      juntarMomentos(resultados[formarClave("IZQ", esquema, "envio")], m);
+    }
+    muestrasPendientes.clear();
+  }
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  double umbral = 1.0; // Cambio mínimo en % para considerarlo
+  double alfa = 0.05;  // Nivel de significación
+  int argumento = 1;
+  while (argumento < argc && strncmp(argv[argumento], "--", 2) == 0)
+  {
+    if (strcmp(argv[argumento], "--umbral") == 0 && argumento + 1 < argc)
+    {
+      umbral = atof(argv[argumento + 1]);
+      argumento += 2;
+    }
+    else if (strcmp(argv[argumento], "--alfa") == 0 && argumento + 1 < argc)
+    {
+      alfa = atof(argv[argumento + 1]);
+      argumento += 2;
+    }
+    else
+    {
+      argumento = argc; // Opción desconocida: mostramos el uso
+    }
+  }
+  if (argc - argumento < 2)
+  {
+    fprintf(stderr, "Uso: %s [--umbral porcentaje] [--alfa nivel] referencia.txt ejecucion.txt [ejecucion.txt ...]\n", argv[0]);
+    return 2;
+  }
+  Resultados referencia;
+  Resultados ejecucion;
+  if (!leerFichero(argv[argumento], referencia))
+  {
+    return 2;
+  }
+  for (int i = argumento + 1; i < argc; i++)
+  {
+    if (!leerFichero(argv[i], ejecucion))
+    {
+      return 2;
+    }
+  }
+
+  int regresiones = 0;
+  printf("%-36s %12s %22s %22s %9s %10s  %s\n", "Esquema", "Magnitud", "Referencia (us)", "Ejecución (us)", "Cambio", "p", "Resultado");
+  for (const auto &entrada : ejecucion)
+  {
+    std::vector<std::string> partes = separarCampos(entrada.first, '|');
+    std::string nombre = partes[0] + " " + partes[1];
+    const Momentos &actual = entrada.second;
+    char textoActual[32];
+    snprintf(textoActual, sizeof(textoActual), "%.1f ± %.1f", actual.media, intervaloConfianza(actual, alfa));
+    auto encontrada = referencia.find(entrada.first);
+    if (encontrada == referencia.end())
+    {
+      printf("%-36s %12s %22s %22s %9s %10s  %s\n", nombre.c_str(), partes[2].c_str(), "-", textoActual, "-", "-", "sin referencia");
+      continue;
+    }
+    const Momentos &base = encontrada->second;
+    char textoBase[32];
+    snprintf(textoBase, sizeof(textoBase), "%.1f ± %.1f", base.media, intervaloConfianza(base, alfa));
+    double cambio = base.media != 0 ? 100.0 * (actual.media - base.media) / base.media : 0.0;
+    // Prueba t de Welch
+    double errorBase = base.muestras > 0 ? varianza(base) / base.muestras : 0.0;
+    double errorActual = actual.muestras > 0 ? varianza(actual) / actual.muestras : 0.0;
+    double errorTotal = errorBase + errorActual;
+    double p;
+    if (errorTotal > 0)
+    {
+      double t = (actual.media - base.media) / sqrt(errorTotal);
+      double denominador = (base.muestras > 1 ? errorBase * errorBase / (base.muestras - 1) : 0.0) +
+                           (actual.muestras > 1 ? errorActual * errorActual / (actual.muestras - 1) : 0.0);
+      double grados = denominador > 0 ? errorTotal * errorTotal / denominador : 1.0;
+      p = pValorT(fabs(t), grados);
+    }
+    else
+    {
+      p = actual.media == base.media ? 1.0 : 0.0; // Sin dispersión cualquier diferencia es real
+    }
+    const char *resultado = "igual";
+    if (p < alfa && fabs(cambio) >= umbral)
+    {
+      resultado = cambio > 0 ? "REGRESIÓN" : "mejora";
+      if (cambio > 0)
+      {
+        regresiones++;
+      }
+    }
+    printf("%-36s %12s %22s %22s %+8.2f%% %10.2g  %s\n", nombre.c_str(), partes[2].c_str(), textoBase, textoActual, cambio, p, resultado);
+  }
+  printf("%d regresiones significativas (alfa %.3g, umbral %.2f %%)\n", regresiones, alfa, umbral);
+  return regresiones > 0 ? 1 : 0;
+}
@@ -0,0 +1,151 @@
+#ifndef HOST_DRIVER_TWAI_H
+#define HOST_DRIVER_TWAI_H
+
+/*
+Sustituto en Linux del driver TWAI de ESP-IDF sobre SocketCAN.
+
+Las estructuras y macros reproducen las de ESP-IDF v4.4 para que el código del
+proyecto compile sin cambios. El bus es la interfaz indicada en la variable de
+entorno CAN_INTERFAZ (por defecto vcan0), por ejemplo:
+  sudo ip link add dev vcan0 type vcan && sudo ip link set up vcan0
+
+Como extensión que no existe en el ESP32, el sustituto admite tramas CAN FD
+de hasta 64 bytes (campos fd y brs del mensaje). Para ello la interfaz tiene
+que admitirlas: sudo ip link set vcan0 mtu 72
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+// Pines, sólo para que compile la configuración del ESP32
+typedef int gpio_num_t;
+#define GPIO_NUM_NC (-1)
+#define GPIO_NUM_9 9
+#define GPIO_NUM_10 10
+#define GPIO_NUM_45 45
+#define GPIO_NUM_48 48
+#define TWAI_IO_UNUSED ((gpio_num_t)-1)
+
+#define TWAI_FRAME_MAX_DLC 8
+// Extensión del sustituto: CAN FD. En las tramas FD data_length_code es la longitud en bytes
+#define TWAI_SUSTITUTO_FD
+#define TWAI_FD_FRAME_MAX_LEN 64
+#define TWAI_MSG_FLAG_NONE 0x00
+#define TWAI_MSG_FLAG_EXTD 0x01
+#define TWAI_MSG_FLAG_RTR 0x02
+
+typedef enum
+{
+  TWAI_MODE_NORMAL,
+  TWAI_MODE_NO_ACK,
+  TWAI_MODE_LISTEN_ONLY,
+} twai_mode_t;
+
+typedef enum
+{
+  TWAI_STATE_STOPPED,
+  TWAI_STATE_RUNNING,
+  TWAI_STATE_BUS_OFF,
+  TWAI_STATE_RECOVERING,
+} twai_state_t;
+
+typedef struct
+{
+  union
+  {
+    struct
+    {
+      uint32_t extd : 1;
+      uint32_t rtr : 1;
+      uint32_t ss : 1;
+      uint32_t self : 1;
+      uint32_t dlc_non_comp : 1;
+      uint32_t fd : 1;  // Trama CAN FD (sólo en el sustituto)
+      uint32_t brs : 1; // Conmutación de bitrate en la fase de datos (sólo en el sustituto)
+      uint32_t reserved : 25;
+    };
+    uint32_t flags;
+  };
+  uint32_t identifier;
+  uint8_t data_length_code;
+  uint8_t data[TWAI_FD_FRAME_MAX_LEN];
+} twai_message_t;
+
+typedef struct
+{
+  uint32_t brp;
+  uint8_t tseg_1;
+  uint8_t tseg_2;
+  uint8_t sjw;
+  bool triple_sampling;
+} twai_timing_config_t;
+
+// Misma fórmula que en el ESP32: reloj de 80 MHz / (brp * (1 + tseg_1 + tseg_2))
+#define TWAI_TIMING_CONFIG_125KBITS() {.brp = 32, .tseg_1 = 15, .tseg_2 = 4, .sjw = 3, .triple_sampling = false}
+#define TWAI_TIMING_CONFIG_250KBITS() {.brp = 16, .tseg_1 = 15, .tseg_2 = 4, .sjw = 3, .triple_sampling = false}
+#define TWAI_TIMING_CONFIG_500KBITS() {.brp = 8, .tseg_1 = 15, .tseg_2 = 4, .sjw = 3, .triple_sampling = false}
+#define TWAI_TIMING_CONFIG_800KBITS() {.brp = 4, .tseg_1 = 16, .tseg_2 = 8, .sjw = 3, .triple_sampling = false}
+#define TWAI_TIMING_CONFIG_1MBITS() {.brp = 4, .tseg_1 = 15, .tseg_2 = 4, .sjw = 3, .triple_sampling = false}
+
+typedef struct
+{
+  uint32_t acceptance_code;
+  uint32_t acceptance_mask;
+  bool single_filter;
+} twai_filter_config_t;
+
+#define TWAI_FILTER_CONFIG_ACCEPT_ALL() {.acceptance_code = 0, .acceptance_mask = 0xFFFFFFFF, .single_filter = true}
+
+typedef struct
+{
+  twai_mode_t mode;
+  gpio_num_t tx_io;
+  gpio_num_t rx_io;
+  gpio_num_t clkout_io;
+  gpio_num_t bus_off_io;
+  uint32_t tx_queue_len;
+  uint32_t rx_queue_len;
+  uint32_t alerts_enabled;
+  uint32_t clkout_divider;
+  int intr_flags;
+} twai_general_config_t;
+
+#define TWAI_ALERT_NONE 0x00000000
+#define TWAI_ALERT_TX_IDLE 0x00000001
+#define TWAI_ALERT_TX_SUCCESS 0x00000002
+#define TWAI_ALERT_RX_DATA 0x00000004
+#define TWAI_ALERT_TX_FAILED 0x00010000
+#define TWAI_ALERT_ALL 0x0001FFFF
+
+#define TWAI_GENERAL_CONFIG_DEFAULT(tx_io_num, rx_io_num, op_mode) {.mode = op_mode, .tx_io = tx_io_num, .rx_io = rx_io_num, \
+                                                                    .clkout_io = TWAI_IO_UNUSED, .bus_off_io = TWAI_IO_UNUSED, \
+                                                                    .tx_queue_len = 5, .rx_queue_len = 5,                      \
+                                                                    .alerts_enabled = TWAI_ALERT_NONE, .clkout_divider = 0,    \
+                                                                    .intr_flags = 0}
+
+typedef struct
+{
+  twai_state_t state;
+  uint32_t msgs_to_tx;
+  uint32_t msgs_to_rx;
+  uint32_t tx_error_counter;
+  uint32_t rx_error_counter;
+  uint32_t tx_failed_count;
+  uint32_t rx_missed_count;
+  uint32_t rx_overrun_count;
+  uint32_t arb_lost_count;
+  uint32_t bus_error_count;
+} twai_status_info_t;
+
+esp_err_t twai_driver_install(const twai_general_config_t *g_config, const twai_timing_config_t *t_config, const twai_filter_config_t *f_config);
+esp_err_t twai_driver_uninstall();
+esp_err_t twai_start();
+esp_err_t twai_stop();
+esp_err_t twai_transmit(const twai_message_t *message, TickType_t ticks_to_wait);
+esp_err_t twai_receive(twai_message_t *message, TickType_t ticks_to_wait);
+esp_err_t twai_read_alerts(uint32_t *alerts, TickType_t ticks_to_wait);
+esp_err_t twai_get_status_info(twai_status_info_t *status_info);
+
+#endif
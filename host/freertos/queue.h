@@ -0,0 +1,15 @@
+#ifndef HOST_FREERTOS_QUEUE_H
+#define HOST_FREERTOS_QUEUE_H
+
+#include "FreeRTOS.h"
+
+typedef struct ColaHost *QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t longitud, UBaseType_t tamanoElemento);
+void vQueueDelete(QueueHandle_t cola);
+BaseType_t xQueueSend(QueueHandle_t cola, const void *elemento, TickType_t espera);
+BaseType_t xQueueReceive(QueueHandle_t cola, void *elemento, TickType_t espera);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t cola);
+BaseType_t xQueueReset(QueueHandle_t cola);
+
+#endif
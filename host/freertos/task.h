@@ -0,0 +1,21 @@
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+typedef struct TareaHost *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+// Crea un hilo POSIX. El núcleo se traduce a afinidad de CPU si existe; la prioridad se ignora
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t funcion, const char *nombre, uint32_t pila, void *parametro,
+                                   UBaseType_t prioridad, TaskHandle_t *tarea, BaseType_t nucleo);
+// Sólo admite NULL (la propia tarea termina)
+void vTaskDelete(TaskHandle_t tarea);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+BaseType_t xPortGetCoreID();
+void taskYIELD();
+
+#endif
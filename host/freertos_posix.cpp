@@ -0,0 +1,159 @@
+// Implementación sobre hilos POSIX del subconjunto de FreeRTOS que usa el proyecto
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+
+struct TareaHost
+{
+  TaskFunction_t funcion;
+  void *parametro;
+};
+
+struct ColaHost
+{
+  std::mutex cerrojo;
+  std::condition_variable hayElementos;
+  std::condition_variable hayHueco;
+  std::vector<uint8_t> almacen; // longitud * tamanoElemento bytes
+  UBaseType_t longitud;
+  UBaseType_t tamanoElemento;
+  UBaseType_t cabeza;
+  UBaseType_t ocupados;
+};
+
+static const std::chrono::steady_clock::time_point instanteArranque = std::chrono::steady_clock::now();
+
+// Espera sobre la variable de condición con la semántica de ticks de FreeRTOS
+template <class Condicion>
+static bool esperarCondicion(std::condition_variable &variable, std::unique_lock<std::mutex> &cerrojo, TickType_t espera, Condicion condicion)
+{
+  if (espera == portMAX_DELAY)
+  {
+    variable.wait(cerrojo, condicion);
+    return true;
+  }
+  return variable.wait_for(cerrojo, std::chrono::milliseconds(espera * portTICK_PERIOD_MS), condicion);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t funcion, const char *nombre, uint32_t pila, void *parametro,
+                                   UBaseType_t prioridad, TaskHandle_t *tarea, BaseType_t nucleo)
+{
+  TareaHost *nueva = new TareaHost{funcion, parametro};
+  std::thread hilo([nueva]()
+                   { nueva->funcion(nueva->parametro); });
+  unsigned int nucleos = std::thread::hardware_concurrency();
+  if (nucleo != tskNO_AFFINITY && nucleos > 0)
+  {
+    cpu_set_t conjunto;
+    CPU_ZERO(&conjunto);
+    CPU_SET((unsigned int)nucleo % nucleos, &conjunto);
+    pthread_setaffinity_np(hilo.native_handle(), sizeof(conjunto), &conjunto);
+  }
+  pthread_setname_np(hilo.native_handle(), nombre);
+  hilo.detach();
+  if (tarea != NULL)
+  {
+    *tarea = nueva;
+  }
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t tarea)
+{
+  if (tarea == NULL)
+  {
+    pthread_exit(NULL);
+  }
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks * portTICK_PERIOD_MS));
+}
+
+TickType_t xTaskGetTickCount()
+{
+  return (TickType_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - instanteArranque).count();
+}
+
+BaseType_t xPortGetCoreID()
+{
+  int nucleo = sched_getcpu();
+  return nucleo < 0 ? 0 : nucleo;
+}
+
+void taskYIELD()
+{
+  std::this_thread::yield();
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t longitud, UBaseType_t tamanoElemento)
+{
+  ColaHost *cola = new ColaHost();
+  cola->almacen.resize((size_t)longitud * tamanoElemento);
+  cola->longitud = longitud;
+  cola->tamanoElemento = tamanoElemento;
+  cola->cabeza = 0;
+  cola->ocupados = 0;
+  return cola;
+}
+
+void vQueueDelete(QueueHandle_t cola)
+{
+  delete cola;
+}
+
+BaseType_t xQueueSend(QueueHandle_t cola, const void *elemento, TickType_t espera)
+{
+  std::unique_lock<std::mutex> cerrojo(cola->cerrojo);
+  if (!esperarCondicion(cola->hayHueco, cerrojo, espera, [cola]()
+                        { return cola->ocupados < cola->longitud; }))
+  {
+    return pdFALSE;
+  }
+  UBaseType_t posicion = (cola->cabeza + cola->ocupados) % cola->longitud;
+  memcpy(&cola->almacen[(size_t)posicion * cola->tamanoElemento], elemento, cola->tamanoElemento);
+  cola->ocupados++;
+  cola->hayElementos.notify_one();
+  return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t cola, void *elemento, TickType_t espera)
+{
+  std::unique_lock<std::mutex> cerrojo(cola->cerrojo);
+  if (!esperarCondicion(cola->hayElementos, cerrojo, espera, [cola]()
+                        { return cola->ocupados > 0; }))
+  {
+    return pdFALSE;
+  }
+  memcpy(elemento, &cola->almacen[(size_t)cola->cabeza * cola->tamanoElemento], cola->tamanoElemento);
+  cola->cabeza = (cola->cabeza + 1) % cola->longitud;
+  cola->ocupados--;
+  cola->hayHueco.notify_one();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t cola)
+{
+  std::lock_guard<std::mutex> cerrojo(cola->cerrojo);
+  return cola->ocupados;
+}
+
+BaseType_t xQueueReset(QueueHandle_t cola)
+{
+  std::lock_guard<std::mutex> cerrojo(cola->cerrojo);
+  cola->cabeza = 0;
+  cola->ocupados = 0;
+  cola->hayHueco.notify_all();
+  return pdPASS;
+}
@@ -0,0 +1,18 @@
+// Punto de entrada en Linux: el mismo ciclo que el núcleo Arduino
+
+#include "Arduino.h"
+
+void setup();
+void loop();
+
+// En las pruebas unitarias el main() es el de la prueba
+#ifndef PIO_UNIT_TESTING
+int main()
+{
+  setup();
+  while (true)
+  {
+    loop();
+  }
+}
+#endif
@@ -0,0 +1,281 @@
+// Implementación del driver TWAI sobre SocketCAN para ejecutar el proyecto en Linux
+
+#include "driver/twai.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+
+static const char *const INTERFAZ_POR_DEFECTO = "vcan0";
+
+static bool driverInstalado = false;
+static int descriptorCAN = -1;
+static twai_general_config_t configuracionGeneral;
+static twai_timing_config_t configuracionTiempos;
+static twai_filter_config_t configuracionFiltro;
+static twai_status_info_t estadoDriver;
+// Alertas producidas y aún no leídas, sólo de las habilitadas
+static std::atomic<uint32_t> alertasPendientes(0);
+
+static const char *nombreInterfaz()
+{
+  const char *interfaz = getenv("CAN_INTERFAZ");
+  return interfaz != NULL ? interfaz : INTERFAZ_POR_DEFECTO;
+}
+
+// Traduce los ticks de FreeRTOS al timeout de poll() en ms
+static int esperaPoll(TickType_t ticks)
+{
+  return ticks == portMAX_DELAY ? -1 : (int)(ticks * portTICK_PERIOD_MS);
+}
+
+// Aplica el filtro de aceptación con la misma semántica que el filtro único del ESP32:
+// los bits a 1 de la máscara no se comparan
+static bool aceptarMensaje(const twai_message_t &mensaje)
+{
+  if (!configuracionFiltro.single_filter)
+  {
+    return true; // El modo de doble filtro no se reproduce, se acepta todo
+  }
+  uint32_t bits;
+  if (mensaje.extd)
+  {
+    bits = (mensaje.identifier << 3) | (mensaje.rtr << 2);
+  }
+  else
+  {
+    bits = (mensaje.identifier << 21) | (mensaje.rtr << 20);
+  }
+  return ((bits ^ configuracionFiltro.acceptance_code) & ~configuracionFiltro.acceptance_mask) == 0;
+}
+
+esp_err_t twai_driver_install(const twai_general_config_t *g_config, const twai_timing_config_t *t_config, const twai_filter_config_t *f_config)
+{
+  if (g_config == NULL || t_config == NULL || f_config == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (driverInstalado)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+  configuracionGeneral = *g_config;
+  configuracionTiempos = *t_config;
+  configuracionFiltro = *f_config;
+  memset(&estadoDriver, 0, sizeof(estadoDriver));
+  estadoDriver.state = TWAI_STATE_STOPPED;
+  alertasPendientes = 0;
+  driverInstalado = true;
+  return ESP_OK;
+}
+
+esp_err_t twai_driver_uninstall()
+{
+  if (!driverInstalado || estadoDriver.state == TWAI_STATE_RUNNING)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+  driverInstalado = false;
+  return ESP_OK;
+}
+
+esp_err_t twai_start()
+{
+  if (!driverInstalado || estadoDriver.state != TWAI_STATE_STOPPED)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+  int descriptor = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+  if (descriptor < 0)
+  {
+    perror("socket CAN");
+    return ESP_FAIL;
+  }
+  struct ifreq interfaz;
+  memset(&interfaz, 0, sizeof(interfaz));
+  strncpy(interfaz.ifr_name, nombreInterfaz(), IFNAMSIZ - 1);
+  if (ioctl(descriptor, SIOCGIFINDEX, &interfaz) < 0)
+  {
+    fprintf(stderr, "No existe la interfaz CAN %s\n", interfaz.ifr_name);
+    close(descriptor);
+    return ESP_FAIL;
+  }
+  struct sockaddr_can direccion;
+  memset(&direccion, 0, sizeof(direccion));
+  direccion.can_family = AF_CAN;
+  direccion.can_ifindex = interfaz.ifr_ifindex;
+  // Admitimos tramas FD; si la interfaz no las soporta sólo fallará el envío de tramas FD
+  int admitirFD = 1;
+  setsockopt(descriptor, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &admitirFD, sizeof(admitirFD));
+  if (bind(descriptor, (struct sockaddr *)&direccion, sizeof(direccion)) < 0)
+  {
+    perror("bind CAN");
+    close(descriptor);
+    return ESP_FAIL;
+  }
+  descriptorCAN = descriptor;
+  estadoDriver.state = TWAI_STATE_RUNNING;
+  return ESP_OK;
+}
+
+esp_err_t twai_stop()
+{
+  if (!driverInstalado || estadoDriver.state != TWAI_STATE_RUNNING)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+  estadoDriver.state = TWAI_STATE_STOPPED;
+  close(descriptorCAN);
+  descriptorCAN = -1;
+  return ESP_OK;
+}
+
+esp_err_t twai_transmit(const twai_message_t *message, TickType_t ticks_to_wait)
+{
+  if (message == NULL || message->data_length_code > (message->fd ? CANFD_MAX_DLEN : TWAI_FRAME_MAX_DLC))
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (estadoDriver.state != TWAI_STATE_RUNNING)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+  // Una trama FD se escribe con su tamaño completo y una clásica con el de can_frame
+  struct canfd_frame trama;
+  memset(&trama, 0, sizeof(trama));
+  trama.can_id = message->identifier;
+  if (message->extd)
+  {
+    trama.can_id |= CAN_EFF_FLAG;
+  }
+  if (message->rtr && !message->fd)
+  {
+    trama.can_id |= CAN_RTR_FLAG;
+  }
+  trama.len = message->data_length_code;
+  if (message->fd && message->brs)
+  {
+    trama.flags |= CANFD_BRS;
+  }
+  memcpy(trama.data, message->data, message->data_length_code);
+  ssize_t tamano = message->fd ? CANFD_MTU : CAN_MTU;
+  // Si la cola de la interfaz está llena se espera a que haya hueco, como la cola TX del driver
+  while (write(descriptorCAN, &trama, tamano) != tamano)
+  {
+    if (errno != ENOBUFS && errno != EAGAIN)
+    {
+      estadoDriver.tx_failed_count++;
+      alertasPendientes |= TWAI_ALERT_TX_FAILED & configuracionGeneral.alerts_enabled;
+      return ESP_FAIL;
+    }
+    struct pollfd espera = {descriptorCAN, POLLOUT, 0};
+    if (poll(&espera, 1, esperaPoll(ticks_to_wait)) <= 0)
+    {
+      return ESP_ERR_TIMEOUT;
+    }
+  }
+  // La trama ya está en la cola de la interfaz y no queda nada en la del driver
+  alertasPendientes |= (TWAI_ALERT_TX_SUCCESS | TWAI_ALERT_TX_IDLE) & configuracionGeneral.alerts_enabled;
+  return ESP_OK;
+}
+
+esp_err_t twai_receive(twai_message_t *message, TickType_t ticks_to_wait)
+{
+  if (message == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (estadoDriver.state != TWAI_STATE_RUNNING)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+  int esperaRestante = esperaPoll(ticks_to_wait);
+  std::chrono::steady_clock::time_point limite = std::chrono::steady_clock::now() + std::chrono::milliseconds(esperaRestante < 0 ? 0 : esperaRestante);
+  while (true)
+  {
+    struct pollfd espera = {descriptorCAN, POLLIN, 0};
+    if (poll(&espera, 1, esperaRestante) <= 0)
+    {
+      return ESP_ERR_TIMEOUT;
+    }
+    // Con CAN_RAW_FD_FRAMES cada lectura devuelve una trama clásica (CAN_MTU) o FD (CANFD_MTU)
+    struct canfd_frame trama;
+    ssize_t leidos = read(descriptorCAN, &trama, sizeof(trama));
+    if ((leidos == CAN_MTU || leidos == CANFD_MTU) && !(trama.can_id & CAN_ERR_FLAG))
+    {
+      bool fd = leidos == CANFD_MTU;
+      uint8_t maximo = fd ? CANFD_MAX_DLEN : TWAI_FRAME_MAX_DLC;
+      memset(message, 0, sizeof(*message));
+      message->extd = (trama.can_id & CAN_EFF_FLAG) ? 1 : 0;
+      message->rtr = (!fd && (trama.can_id & CAN_RTR_FLAG)) ? 1 : 0;
+      message->fd = fd;
+      message->brs = (fd && (trama.flags & CANFD_BRS)) ? 1 : 0;
+      message->identifier = trama.can_id & (message->extd ? CAN_EFF_MASK : CAN_SFF_MASK);
+      message->data_length_code = trama.len > maximo ? maximo : trama.len;
+      memcpy(message->data, trama.data, message->data_length_code);
+      if (aceptarMensaje(*message))
+      {
+        return ESP_OK;
+      }
+    }
+    // Mensaje filtrado: seguimos esperando lo que quede del timeout
+    if (esperaRestante > 0)
+    {
+      long quedan = std::chrono::duration_cast<std::chrono::milliseconds>(limite - std::chrono::steady_clock::now()).count();
+      esperaRestante = quedan > 0 ? (int)quedan : 0;
+    }
+  }
+}
+
+esp_err_t twai_read_alerts(uint32_t *alerts, TickType_t ticks_to_wait)
+{
+  if (alerts == NULL)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  if (!driverInstalado)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+  *alerts = alertasPendientes.exchange(0);
+  if (*alerts != 0)
+  {
+    return ESP_OK;
+  }
+  // Las alertas se producen al transmitir desde otro hilo: se mira cada milisegundo hasta agotar la espera
+  int esperaRestante = esperaPoll(ticks_to_wait);
+  while (esperaRestante != 0)
+  {
+    poll(NULL, 0, 1);
+    *alerts = alertasPendientes.exchange(0);
+    if (*alerts != 0)
+    {
+      return ESP_OK;
+    }
+    if (esperaRestante > 0)
+    {
+      esperaRestante--;
+    }
+  }
+  return ESP_ERR_TIMEOUT;
+}
+
+esp_err_t twai_get_status_info(twai_status_info_t *status_info)
+{
+  if (!driverInstalado)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+  *status_info = estadoDriver;
+  return ESP_OK;
+}
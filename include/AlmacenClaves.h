@@ -0,0 +1,91 @@
+#ifndef ALMACEN_CLAVES_H
+#define ALMACEN_CLAVES_H
+
+/*
+Almacén de claves RSA, de curva elíptica P-256 y Ed25519.
+
+Las claves se parsean una única vez en setup() y se mantienen vivas durante
+toda la ejecución, de forma que el parseo PEM/ASN.1 y el cálculo de las
+constantes de Montgomery (RN/RP/RQ) no se cuentan en cada mensaje. Las claves
+privadas RSA también dejan calculado el primer par de cegado, así que el
+generador aleatorio tiene que estar sembrado antes de cargarlas. En las
+claves P-256 lo que se precalcula es la tabla de múltiplos del generador que
+mbedtls guarda en el grupo tras la primera multiplicación por G.
+
+mbedtls 2.28 no tiene Ed25519, que sale de la librería Crypto de rweather
+(lib_deps en platformio.ini). Si la librería no está, FIRMA_ED25519 queda sin
+definir y el esquema Ed25519 no se compila.
+*/
+
+#include <stdint.h>
+#include <mbedtls/pk.h>
+#include <mbedtls/rsa.h>
+#include <mbedtls/ecp.h>
+
+#if __has_include(<Ed25519.h>)
+#define FIRMA_ED25519
+#endif
+
+// Longitud de un escalar o de una coordenada de P-256 y de las claves Ed25519
+const uint8_t LONGITUD_CLAVE_EC = 32;
+
+// Clave RSA ya parseada junto con los tiempos de preparación
+struct ClaveRSA
+{
+  mbedtls_pk_context contextoClave;   // Contexto de la clave parseada
+  mbedtls_rsa_context *contextoRSA;   // Contexto RSA dentro de contextoClave
+  bool privada;                       // Si es true, la clave contiene la parte privada
+  bool cargada;                       // Si es true, la clave está lista para usarse
+  unsigned long tiempoParseo;         // Tiempo de parseo de la clave en us
+  unsigned long tiempoMontgomery;     // Tiempo de la primera operación, que calcula RN/RP/RQ y el cegado, en us
+};
+
+// Parsea la clave privada en PEM y precalcula las constantes de Montgomery
+bool cargarClavePrivadaRSA(ClaveRSA &clave, const char *pem);
+// Parsea la clave pública en PEM y precalcula la constante de Montgomery
+bool cargarClavePublicaRSA(ClaveRSA &clave, const char *pem);
+// Libera la clave (sólo si se quiere recuperar la memoria)
+void liberarClaveRSA(ClaveRSA &clave);
+// Muestra por el puerto serie el coste de preparación de la clave
+void mostrarCosteClaveRSA(const ClaveRSA &clave, const char *nombre);
+
+// Clave de curva elíptica P-256 ya parseada junto con los tiempos de preparación
+struct ClaveEC
+{
+  mbedtls_pk_context contextoClave;  // Contexto de la clave parseada
+  mbedtls_ecp_keypair *contextoEC;   // Grupo, parte privada d y parte pública Q dentro de contextoClave
+  bool privada;                      // Si es true, la clave contiene la parte privada
+  bool cargada;                      // Si es true, la clave está lista para usarse
+  unsigned long tiempoParseo;        // Tiempo de parseo de la clave en us
+  unsigned long tiempoPrecalculo;    // Tiempo de la primera multiplicación por G, que calcula la tabla, en us
+};
+
+// Parsea la clave privada en PEM y precalcula la tabla del generador
+bool cargarClavePrivadaEC(ClaveEC &clave, const char *pem);
+// Parsea la clave pública en PEM y precalcula la tabla del generador
+bool cargarClavePublicaEC(ClaveEC &clave, const char *pem);
+// Libera la clave (sólo si se quiere recuperar la memoria)
+void liberarClaveEC(ClaveEC &clave);
+// Muestra por el puerto serie el coste de preparación de la clave
+void mostrarCosteClaveEC(const ClaveEC &clave, const char *nombre);
+
+#ifdef FIRMA_ED25519
+// Clave Ed25519: semilla privada de 32 bytes y clave pública de 32 bytes
+struct ClaveEd25519
+{
+  uint8_t semilla[LONGITUD_CLAVE_EC]; // Clave privada (sólo en el lado que firma)
+  uint8_t publica[LONGITUD_CLAVE_EC];
+  bool privada;                       // Si es true, la clave contiene la semilla
+  bool cargada;                       // Si es true, la clave está lista para usarse
+  unsigned long tiempoDerivacion;     // Tiempo de derivación de la clave pública a partir de la semilla, en us
+};
+
+// Guarda la semilla, deriva la clave pública y comprueba que coincide con la esperada
+bool cargarClavePrivadaEd25519(ClaveEd25519 &clave, const uint8_t *semilla, const uint8_t *publica);
+// Guarda la clave pública
+bool cargarClavePublicaEd25519(ClaveEd25519 &clave, const uint8_t *publica);
+// Muestra por el puerto serie el coste de preparación de la clave
+void mostrarCosteClaveEd25519(const ClaveEd25519 &clave, const char *nombre);
+#endif
+
+#endif
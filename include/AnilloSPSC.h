@@ -0,0 +1,69 @@
+#ifndef ANILLO_SPSC_H
+#define ANILLO_SPSC_H
+
+/*
+Anillo sin bloqueos de un productor y un consumidor (SPSC).
+
+Los elementos están reservados de antemano dentro del anillo. El productor
+pide un hueco con reservar(), lo rellena en el sitio y lo publica con
+publicar(); el consumidor mira el elemento más antiguo con frente() y lo
+devuelve con liberar(). Cada índice sólo lo escribe un lado, así que basta
+con cargas y almacenamientos atómicos con orden acquire/release, sin
+secciones críticas, y el productor y el consumidor pueden estar en núcleos
+distintos.
+*/
+
+#include <stdint.h>
+#include <atomic>
+
+template <class T, uint32_t N>
+struct AnilloSPSC
+{
+  static_assert(N > 0 && (N & (N - 1)) == 0, "La capacidad del anillo tiene que ser potencia de dos");
+
+  T elementos[N];
+  std::atomic<uint32_t> cabeza{0}; // Siguiente posición a escribir, sólo la escribe el productor
+  std::atomic<uint32_t> cola{0};   // Siguiente posición a leer, sólo la escribe el consumidor
+
+  // Productor: hueco libre para escribir, o NULL si el anillo está lleno
+  T *reservar()
+  {
+    uint32_t posicion = cabeza.load(std::memory_order_relaxed);
+    if (posicion - cola.load(std::memory_order_acquire) == N)
+    {
+      return NULL;
+    }
+    return &elementos[posicion & (N - 1)];
+  }
+
+  // Productor: deja visible para el consumidor el hueco reservado
+  void publicar()
+  {
+    cabeza.store(cabeza.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  // Consumidor: elemento más antiguo, o NULL si el anillo está vacío
+  T *frente()
+  {
+    uint32_t posicion = cola.load(std::memory_order_relaxed);
+    if (cabeza.load(std::memory_order_acquire) == posicion)
+    {
+      return NULL;
+    }
+    return &elementos[posicion & (N - 1)];
+  }
+
+  // Consumidor: devuelve al productor el elemento más antiguo
+  void liberar()
+  {
+    cola.store(cola.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+  }
+
+  // Elementos publicados y todavía no liberados
+  uint32_t ocupacion() const
+  {
+    return cabeza.load(std::memory_order_acquire) - cola.load(std::memory_order_acquire);
+  }
+};
+
+#endif
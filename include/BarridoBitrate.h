@@ -0,0 +1,70 @@
+#ifndef BARRIDO_BITRATE_H
+#define BARRIDO_BITRATE_H
+
+/*
+Barrido del bitrate del bus sin volver a grabar las placas.
+
+Si se define BARRIDO_BITRATE los dos lados repiten todos los esquemas con
+cada bitrate de BITRATES_BARRIDO. Entre un bitrate y el siguiente el lado
+izquierdo pide el cambio con una trama de control con el bitrate actual; el
+derecho lo acepta, deja pasar un rato sin peticiones repetidas y reinstala el
+driver, y el izquierdo, que espera algo más, lo reinstala después. Así nadie
+transmite mientras los dos lados tienen bitrates distintos, que llenaría el
+bus de tramas de error. Ya con el bitrate nuevo el izquierdo repite una trama
+de sincronización hasta que el derecho contesta, y empieza a medir.
+
+Al final el lado izquierdo muestra la matriz de latencia frente a bitrate: la
+media de cada iteración de cada esquema y, entre paréntesis, la parte de ella
+que es el tiempo mínimo en el bus de la PDU y la respuesta. Mientras esa parte
+es grande el esquema está limitado por el bus y la latencia baja al subir el
+bitrate; cuando es pequeña lo limita la CPU y subir el bitrate apenas cambia
+nada. La última columna indica desde qué bitrate pasa a estar limitado por la
+CPU. Con SALIDA_CSV el nombre de cada esquema lleva detrás el bitrate, para
+que el comparador no junte las medidas de distintos bitrates.
+
+Las tramas de control van con el identificador de cada lado y su primer byte
+no es una cabecera válida del transporte, así que no se confunden con las
+PDUs. El generador de tráfico no cambia de bitrate: no se puede usar con el
+barrido.
+*/
+
+#include <Arduino.h>
+#include <driver/twai.h>
+
+// #define BARRIDO_BITRATE // Si está definido, se repiten los esquemas con cada bitrate de BITRATES_BARRIDO
+
+// Bitrates del barrido en bit/s, en el orden en que se miden
+const uint32_t BITRATES_BARRIDO[] = {125000, 250000, 500000, 1000000};
+const uint8_t PUNTOS_BARRIDO = sizeof(BITRATES_BARRIDO) / sizeof(BITRATES_BARRIDO[0]);
+// Esquemas como máximo en la matriz
+const uint8_t MAX_ESQUEMAS_BARRIDO = 32;
+// Espera de cada intento de las peticiones; los periodos sin peticiones repetidas son de 2 y 3 esperas
+const TickType_t ESPERA_CONTROL_BARRIDO = pdMS_TO_TICKS(100);
+// Parte del tiempo en el bus por debajo de la cual el esquema se considera limitado por la CPU, en %
+const uint8_t LIMITE_BUS_BARRIDO = 50;
+
+// Configuración de tiempos del TWAI para un bitrate de 125k, 250k, 500k, 800k o 1M. Devuelve false con otro
+bool tiemposBitrateCAN(uint32_t bitrate, twai_timing_config_t *tiempos);
+
+#ifdef BARRIDO_BITRATE
+// Guarda la configuración con la que setup() ha instalado el driver, para reinstalarlo con cada
+// bitrate, y el identificador con el que este lado envía las tramas de control
+void iniciarBarridoBitrate(const twai_general_config_t &general, const twai_filter_config_t &filtro, const twai_timing_config_t &tiempos,
+                           uint32_t identificador, bool extendido);
+// Lado izquierdo: pasa con el derecho al punto del barrido indicado. Con PUNTOS_BARRIDO le indica que ha terminado
+void proponerBitrateCAN(uint8_t punto);
+// Lado derecho: espera a que el izquierdo pida un punto y pasa a él. Devuelve el punto, o PUNTOS_BARRIDO al terminar
+uint8_t aceptarBitrateCAN();
+// Configuración de tiempos del bitrate en uso
+const twai_timing_config_t &tiemposBarridoBitrate();
+// Nombre del esquema con el bitrate en uso detrás, para las líneas CSV
+const char *nombreBarridoBitrate(const char *esquema);
+// Lado izquierdo: anota la media de una iteración del esquema y su tiempo mínimo en el bus con el bitrate en uso, en us
+void anotarBarridoBitrate(const char *esquema, double latenciaMedia, double tiempoBus);
+// Muestra la matriz de latencia frente a bitrate
+void mostrarBarridoBitrate();
+#else
+inline const char *nombreBarridoBitrate(const char *esquema) { return esquema; }
+#endif
+
+#endif
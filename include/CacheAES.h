@@ -0,0 +1,27 @@
+#ifndef CACHE_AES_H
+#define CACHE_AES_H
+
+/*
+Caché de contextos AES.
+
+Cada contexto se identifica por la clave, su longitud y el sentido (cifrado o
+descifrado). La expansión de la clave se hace una única vez y el contexto se
+reutiliza en todos los mensajes, de forma que en régimen permanente sólo se
+paga la operación de bloque.
+*/
+
+#include <stdint.h>
+#include <mbedtls/aes.h>
+
+// Número máximo de contextos guardados en la caché
+const uint8_t MAX_CONTEXTOS_AES = 8;
+
+// Devuelve el contexto con la clave ya expandida, creándolo si no existe.
+// El sentido es MBEDTLS_AES_ENCRYPT o MBEDTLS_AES_DECRYPT. Devuelve NULL si la caché está llena
+mbedtls_aes_context *obtenerContextoAES(const uint8_t *clave, uint16_t bits, int sentido);
+// Muestra por el puerto serie el coste de la expansión de clave de cada contexto
+void mostrarCosteCacheAES();
+// Libera todos los contextos de la caché
+void vaciarCacheAES();
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef CIFRADO_CTR_H
+#define CIFRADO_CTR_H
+
+/*
+Cifrado AES en modo contador para cargas CAN.
+
+El bloque de contador se forma con el identificador CAN, un contador de
+mensajes que llevan emisor y receptor, un dominio y el número de bloque
+dentro del mensaje. Los esquemas que comparten clave e identificador CAN
+usan dominios distintos, así que nunca cifran con el mismo flujo aunque sus
+contadores empiecen igual. El cifrado de ese bloque es el flujo de cifrado, que se combina con
+los datos por XOR, así que el mensaje cifrado tiene la misma longitud que el
+original y 8 bytes siguen cabiendo en una sola trama.
+
+El modo contador sólo da confidencialidad: no detecta modificaciones ni
+pérdidas, y un mensaje perdido desincroniza el contador. Para eso está SecOC.
+*/
+
+#include <stdint.h>
+#include <mbedtls/aes.h>
+
+const uint8_t LONGITUD_BLOQUE_CTR = 16;
+
+// Forma el bloque de contador: identificador CAN (4 bytes), contador de mensajes (8), dominio (1) y número de bloque (3)
+void formarBloqueCTR(uint32_t identificador, uint8_t dominio, uint64_t contador, uint32_t bloque, uint8_t *salida);
+// Genera los 16 bytes de flujo de cifrado del primer bloque de un mensaje
+void generarFlujoCTR(mbedtls_aes_context *cifrador, uint32_t identificador, uint8_t dominio, uint64_t contador, uint8_t *flujo);
+// salida = entrada XOR flujo. salida puede ser la propia entrada para cifrar o descifrar en el sitio
+void aplicarFlujoCTR(const uint8_t *flujo, const uint8_t *entrada, uint8_t *salida, uint8_t longitud);
+
+#endif
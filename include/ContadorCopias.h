@@ -0,0 +1,40 @@
+#ifndef CONTADOR_COPIAS_H
+#define CONTADOR_COPIAS_H
+
+/*
+Bytes copiados por mensaje.
+
+Si se define CONTAR_COPIAS cada copia que hace el benchmark de una trama o de
+una PDU suma sus bytes a la cuenta del envío o de la recepción, y tras cada
+esquema se muestran los bytes copiados por mensaje. Sólo se cuentan las
+copias del código del benchmark: las del driver TWAI (de la trama a su cola y
+al controlador) y la de cada esquema al escribir su salida no se pueden
+evitar. Las copias de una estructura entera cuentan su tamaño, no sólo los
+datos de la trama. Sin CONTAR_COPIAS no genera código.
+*/
+
+#include <Arduino.h>
+
+// #define CONTAR_COPIAS // Si está definido, se cuentan los bytes que copia el benchmark en cada mensaje
+
+// Sentido de la copia
+enum SentidoCopia : uint8_t
+{
+  COPIA_ENVIO,
+  COPIA_RECEPCION
+};
+
+#ifdef CONTAR_COPIAS
+// Suma los bytes de una copia. Se puede llamar desde la tarea receptora
+void contarCopia(SentidoCopia sentido, uint32_t bytes);
+// Pone a cero las cuentas
+void reiniciarCopias();
+// Muestra los bytes copiados en cada sentido por cada uno de los mensajes indicados
+void mostrarCopias(const char *nombre, uint32_t mensajes);
+#else
+inline void contarCopia(SentidoCopia sentido, uint32_t bytes) {}
+inline void reiniciarCopias() {}
+inline void mostrarCopias(const char *nombre, uint32_t mensajes) {}
+#endif
+
+#endif
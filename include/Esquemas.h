@@ -0,0 +1,523 @@
+#ifndef ESQUEMAS_H
+#define ESQUEMAS_H
+
+/*
+Políticas de los esquemas de seguridad que mide el motor (ver MotorBenchmark.h).
+
+Para añadir un esquema basta con escribir una política con LONGITUD_PDU,
+preparar(), proteger() y verificar() y añadir una línea al registro de main.cpp.
+*/
+
+#include <Arduino.h>
+#include <mbedtls/aes.h>
+#include <mbedtls/md5.h>
+#include <mbedtls/sha1.h>
+#include <mbedtls/sha256.h> //Esta librería incluye SHA-224 y SHA-256
+#include <mbedtls/sha512.h> //Esta librería incluye SHA-384 y SHA-512
+#include <mbedtls/rsa.h>
+#include <mbedtls/md.h>
+#include "AlmacenClaves.h"
+#include "FirmaEC.h"
+#include "GeneradorAleatorio.h"
+#include "RSAParalelo.h"
+#include "CacheAES.h"
+#include "MotorCMAC.h"
+#include "MotorHMAC.h"
+#include "CifradoCTR.h"
+#include "ReservaFlujoCTR.h"
+#include "MotorBenchmark.h"
+#ifdef FIRMA_ED25519
+#include <Ed25519.h>
+#endif
+
+// Envío de los datos sin cifrar
+struct EsquemaSinCifrar
+{
+  static const uint16_t LONGITUD_PDU = LONGITUD_MENSAJE_CAN;
+
+  static void preparar(bool emisor) {}
+
+  static void proteger(const uint8_t *datos, uint8_t *pdu)
+  {
+    memcpy(pdu, datos, LONGITUD_MENSAJE_CAN);
+  }
+
+  static bool verificar(const uint8_t *pdu, uint8_t *datos)
+  {
+    memcpy(datos, pdu, LONGITUD_MENSAJE_CAN);
+    return true;
+  }
+};
+
+// Cifrado AES en modo ECB: los 8 bytes de datos se rellenan con ceros hasta un bloque de 16 bytes
+template <const uint8_t *CLAVE, uint16_t BITS>
+struct EsquemaAES
+{
+  static const uint16_t LONGITUD_PDU = 16;
+  inline static mbedtls_aes_context *cifrador = NULL; // Contexto de la caché con la clave ya expandida
+
+  static void preparar(bool emisor)
+  {
+    cifrador = obtenerContextoAES(CLAVE, BITS, emisor ? MBEDTLS_AES_ENCRYPT : MBEDTLS_AES_DECRYPT);
+  }
+
+  static void proteger(const uint8_t *datos, uint8_t *pdu)
+  {
+    uint8_t entrada[LONGITUD_PDU] = {0}; // Padding ya que la entrada del cifrador es de 16 bytes
+    memcpy(entrada, datos, LONGITUD_MENSAJE_CAN);
+    mbedtls_aes_crypt_ecb(cifrador, MBEDTLS_AES_ENCRYPT, entrada, pdu);
+  }
+
+  static bool verificar(const uint8_t *pdu, uint8_t *datos)
+  {
+    uint8_t salida[LONGITUD_PDU];
+    mbedtls_aes_crypt_ecb(cifrador, MBEDTLS_AES_DECRYPT, pdu, salida);
+    memcpy(datos, salida, LONGITUD_MENSAJE_CAN);
+    // El padding tiene que haber vuelto a ser todo ceros
+    for (uint8_t i = LONGITUD_MENSAJE_CAN; i < LONGITUD_PDU; i++)
+    {
+      if (salida[i] != 0)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+// Cifrado AES en modo contador: el mensaje cifrado mide lo mismo que los datos y va en una sola trama.
+// El nonce sale del identificador CAN, de un contador de mensajes que llevan los dos lados y
+// del dominio, distinto en cada esquema del registro con la misma clave e identificador CAN.
+// Con MODO_MULTINODO el contador es por emisor y el identificador del nonce es el bloque del emisor.
+// Con CON_RESERVA el flujo de cifrado sale de la reserva calculada en el otro núcleo
+template <const uint8_t *CLAVE, uint16_t BITS, uint32_t ID_CAN, uint8_t DOMINIO, bool CON_RESERVA = false>
+struct EsquemaAESCTR
+{
+  static const uint16_t LONGITUD_PDU = LONGITUD_MENSAJE_CAN;
+  inline static mbedtls_aes_context *cifrador = NULL; // En modo contador los dos lados cifran
+  inline static uint64_t contador[MAX_NODOS_CAN] = {}; // Siguiente contador de cada emisor
+  inline static int8_t flujoReserva = -1; // Índice del flujo en la reserva, -1 si no se usa
+  inline static uint8_t nodoReserva = 0;  // Emisor cuyo flujo calcula la reserva
+
+  // Identificador CAN del nonce de los mensajes del emisor
+  static uint32_t identificadorNonce(uint8_t nodo)
+  {
+#ifdef MODO_MULTINODO
+    return bloqueNodoTopologiaCAN(nodo);
+#else
+    return ID_CAN;
+#endif
+  }
+
+  static void preparar(bool emisor)
+  {
+    cifrador = obtenerContextoAES(CLAVE, BITS, MBEDTLS_AES_ENCRYPT);
+    memset(contador, 0, sizeof(contador));
+    if (CON_RESERVA)
+    {
+      // La reserva lleva un solo flujo: el del propio emisor o el del primer emisor en el receptor.
+      // Con varios emisores el de los demás se calcula en el momento
+      nodoReserva = emisor ? nodoLocalTopologiaCAN() : primerEmisorTopologiaCAN();
+      flujoReserva = registrarFlujoCTR(cifrador, identificadorNonce(nodoReserva), DOMINIO, 0);
+    }
+  }
+
+  // salida = entrada XOR flujo del siguiente contador del emisor
+  static void aplicar(uint8_t nodo, const uint8_t *entrada, uint8_t *salida)
+  {
+    if (flujoReserva >= 0 && nodo == nodoReserva)
+    {
+      aplicarFlujoReservaCTR(flujoReserva, contador[nodo]++, entrada, salida, LONGITUD_MENSAJE_CAN);
+      return;
+    }
+    uint8_t flujo[LONGITUD_BLOQUE_CTR];
+    generarFlujoCTR(cifrador, identificadorNonce(nodo), DOMINIO, contador[nodo]++, flujo);
+    aplicarFlujoCTR(flujo, entrada, salida, LONGITUD_MENSAJE_CAN);
+  }
+
+  static void proteger(const uint8_t *datos, uint8_t *pdu)
+  {
+    aplicar(nodoLocalTopologiaCAN(), datos, pdu);
+  }
+
+  static bool verificar(const uint8_t *pdu, uint8_t *datos)
+  {
+    aplicar(nodoOrigenPDU(), pdu, datos);
+    // Sin MAC sólo se puede comprobar que con el contador del receptor salen los datos de prueba
+    return sonDatosPrueba(datos);
+  }
+};
+
+// Funciones resumen: cada una indica su longitud y cómo se calcula
+struct ResumenMD5
+{
+  static const uint8_t LONGITUD = 16;
+  static void calcular(const uint8_t *entrada, size_t longitud, uint8_t *salida) { mbedtls_md5_ret(entrada, longitud, salida); }
+};
+
+struct ResumenSHA1
+{
+  static const uint8_t LONGITUD = 20;
+  static void calcular(const uint8_t *entrada, size_t longitud, uint8_t *salida) { mbedtls_sha1_ret(entrada, longitud, salida); }
+};
+
+struct ResumenSHA224
+{
+  static const uint8_t LONGITUD = 28;
+  static void calcular(const uint8_t *entrada, size_t longitud, uint8_t *salida) { mbedtls_sha256_ret(entrada, longitud, salida, 1); }
+};
+
+struct ResumenSHA256
+{
+  static const uint8_t LONGITUD = 32;
+  static void calcular(const uint8_t *entrada, size_t longitud, uint8_t *salida) { mbedtls_sha256_ret(entrada, longitud, salida, 0); }
+};
+
+struct ResumenSHA384
+{
+  static const uint8_t LONGITUD = 48;
+  static void calcular(const uint8_t *entrada, size_t longitud, uint8_t *salida) { mbedtls_sha512_ret(entrada, longitud, salida, 1); }
+};
+
+struct ResumenSHA512
+{
+  static const uint8_t LONGITUD = 64;
+  static void calcular(const uint8_t *entrada, size_t longitud, uint8_t *salida) { mbedtls_sha512_ret(entrada, longitud, salida, 0); }
+};
+
+// Datos en claro seguidos de su resumen. El receptor recalcula el resumen y lo compara
+template <class Resumen>
+struct EsquemaResumen
+{
+  static const uint16_t LONGITUD_PDU = LONGITUD_MENSAJE_CAN + Resumen::LONGITUD;
+
+  static void preparar(bool emisor) {}
+
+  static void proteger(const uint8_t *datos, uint8_t *pdu)
+  {
+    memcpy(pdu, datos, LONGITUD_MENSAJE_CAN);
+    Resumen::calcular(datos, LONGITUD_MENSAJE_CAN, pdu + LONGITUD_MENSAJE_CAN);
+  }
+
+  static bool verificar(const uint8_t *pdu, uint8_t *datos)
+  {
+    uint8_t resumenCalculado[Resumen::LONGITUD];
+    memcpy(datos, pdu, LONGITUD_MENSAJE_CAN);
+    Resumen::calcular(datos, LONGITUD_MENSAJE_CAN, resumenCalculado);
+    // Ahora comparamos el resumen calculado con el resumen recibido
+    return memcmp(resumenCalculado, pdu + LONGITUD_MENSAJE_CAN, Resumen::LONGITUD) == 0;
+  }
+};
+
+// Datos en claro seguidos de su HMAC completo con una clave de 128 bits. Con PRECALCULADO cada
+// mensaje clona los estados de ipad y opad de la clave; sin él la vuelve a cargar (hmac_starts)
+template <mbedtls_md_type_t TIPO, const uint8_t *CLAVE, bool PRECALCULADO = true>
+struct EsquemaHMAC
+{
+  static const uint8_t LONGITUD_CLAVE = 16;
+  static const uint16_t LONGITUD_PDU = LONGITUD_MENSAJE_CAN + (TIPO == MBEDTLS_MD_SHA1     ? 20
+                                                               : TIPO == MBEDTLS_MD_SHA224 ? 28
+                                                               : TIPO == MBEDTLS_MD_SHA256 ? 32
+                                                               : TIPO == MBEDTLS_MD_SHA384 ? 48
+                                                                                           : 64);
+  inline static ContextoHMAC *contexto = NULL; // Clave con los estados intermedios ya calculados
+
+  static void preparar(bool emisor)
+  {
+    contexto = obtenerContextoHMAC(TIPO, CLAVE, LONGITUD_CLAVE);
+  }
+
+  static void calcular(const uint8_t *datos, uint8_t *mac)
+  {
+    if (PRECALCULADO)
+    {
+      calcularHMAC(contexto, datos, LONGITUD_MENSAJE_CAN, mac);
+    }
+    else
+    {
+      calcularHMACSinPrecalculo(contexto, datos, LONGITUD_MENSAJE_CAN, mac);
+    }
+  }
+
+  static void proteger(const uint8_t *datos, uint8_t *pdu)
+  {
+    uint8_t mac[MBEDTLS_MD_MAX_SIZE];
+    memcpy(pdu, datos, LONGITUD_MENSAJE_CAN);
+    calcular(datos, mac);
+    memcpy(pdu + LONGITUD_MENSAJE_CAN, mac, LONGITUD_PDU - LONGITUD_MENSAJE_CAN);
+  }
+
+  static bool verificar(const uint8_t *pdu, uint8_t *datos)
+  {
+    uint8_t mac[MBEDTLS_MD_MAX_SIZE];
+    memcpy(datos, pdu, LONGITUD_MENSAJE_CAN);
+    calcular(datos, mac);
+    // Ahora comparamos el MAC calculado con el MAC recibido
+    return memcmp(mac, pdu + LONGITUD_MENSAJE_CAN, LONGITUD_PDU - LONGITUD_MENSAJE_CAN) == 0;
+  }
+};
+
+// Autenticadores para SecOC: HMAC con una función resumen de mbedtls y una clave de 128 bits.
+// Los estados de ipad y opad se calculan una vez en preparar(); en cada mensaje se clonan,
+// que es la fase "Clave" de la traza por fases
+template <mbedtls_md_type_t TIPO, const uint8_t *CLAVE>
+struct AutenticadorHMAC
+{
+  static const uint8_t LONGITUD_CLAVE = 16;
+  inline static ContextoHMAC *contexto = NULL;
+
+  static void preparar()
+  {
+    contexto = obtenerContextoHMAC(TIPO, CLAVE, LONGITUD_CLAVE);
+  }
+
+  // Deja el MAC completo en salida, que tiene que tener sitio para MBEDTLS_MD_MAX_SIZE bytes
+  static void calcular(const uint8_t *entrada, size_t longitud, uint8_t *salida)
+  {
+    calcularHMAC(contexto, entrada, longitud, salida);
+  }
+};
+
+// Autenticador CMAC con una clave AES, el de los perfiles de SecOC
+template <const uint8_t *CLAVE, uint16_t BITS>
+struct AutenticadorCMAC
+{
+  inline static const ContextoCMAC *contexto = NULL;
+
+  static void preparar()
+  {
+    contexto = obtenerContextoCMAC(CLAVE, BITS);
+  }
+
+  static void calcular(const uint8_t *entrada, size_t longitud, uint8_t *salida)
+  {
+    calcularCMAC(contexto, entrada, longitud, salida);
+  }
+};
+
+// PDU autenticada al estilo de AUTOSAR SecOC: datos, valor de frescura truncado y MAC truncado.
+// El MAC se calcula sobre el identificador de datos, los datos y el valor de frescura completo
+// (un contador de 64 bits), así que no se puede recalcular sin la clave. El receptor reconstruye
+// la frescura completa a partir de la truncada y sólo acepta valores posteriores al último aceptado.
+// Con MODO_MULTINODO cada emisor lleva su frescura y el receptor una por emisor.
+// Con 4 bytes de datos, 1 de frescura y 3 de MAC la PDU cabe en una única trama clásica
+template <class Autenticador, uint16_t ID_DATOS, uint8_t LONGITUD_DATOS, uint8_t BYTES_FRESCURA, uint8_t BYTES_MAC>
+struct EsquemaSecOC
+{
+  static_assert(LONGITUD_DATOS <= LONGITUD_MENSAJE_CAN, "Los datos autenticados salen de los 8 bytes del mensaje");
+  static_assert(BYTES_FRESCURA >= 1 && BYTES_FRESCURA <= 8, "La frescura truncada va de 1 a 8 bytes");
+  static const uint16_t LONGITUD_PDU = LONGITUD_DATOS + BYTES_FRESCURA + BYTES_MAC;
+  // Entrada del MAC: identificador de datos, datos y frescura completa
+  static const uint8_t LONGITUD_ENTRADA_MAC = 2 + LONGITUD_DATOS + 8;
+  // Último valor enviado por el propio emisor o último aceptado de cada emisor en el receptor
+  inline static uint64_t frescura[MAX_NODOS_CAN] = {};
+
+  static void preparar(bool emisor)
+  {
+    Autenticador::preparar();
+    memset(frescura, 0, sizeof(frescura));
+  }
+
+  static void calcularMAC(const uint8_t *datos, uint64_t valorFrescura, uint8_t *mac)
+  {
+    uint8_t entrada[LONGITUD_ENTRADA_MAC];
+    entrada[0] = ID_DATOS >> 8;
+    entrada[1] = ID_DATOS & 0xFF;
+    memcpy(entrada + 2, datos, LONGITUD_DATOS);
+    for (uint8_t i = 0; i < 8; i++)
+    {
+      entrada[2 + LONGITUD_DATOS + i] = valorFrescura >> (8 * (7 - i));
+    }
+    Autenticador::calcular(entrada, LONGITUD_ENTRADA_MAC, mac);
+  }
+
+  static void proteger(const uint8_t *datos, uint8_t *pdu)
+  {
+    uint8_t mac[MBEDTLS_MD_MAX_SIZE];
+    uint64_t &enviada = frescura[nodoLocalTopologiaCAN()];
+    enviada++;
+    calcularMAC(datos, enviada, mac);
+    // Datos, bytes bajos de la frescura y bytes altos del MAC
+    memcpy(pdu, datos, LONGITUD_DATOS);
+    for (uint8_t i = 0; i < BYTES_FRESCURA; i++)
+    {
+      pdu[LONGITUD_DATOS + i] = enviada >> (8 * (BYTES_FRESCURA - 1 - i));
+    }
+    memcpy(pdu + LONGITUD_DATOS + BYTES_FRESCURA, mac, BYTES_MAC);
+  }
+
+  static bool verificar(const uint8_t *pdu, uint8_t *datos)
+  {
+    uint8_t mac[MBEDTLS_MD_MAX_SIZE];
+    uint64_t &aceptada = frescura[nodoOrigenPDU()];
+    // Reconstruimos la frescura completa: la parte alta es la del último valor aceptado y,
+    // si la parte truncada no es mayor que la suya, es que la parte baja ha dado la vuelta
+    uint64_t truncada = 0;
+    for (uint8_t i = 0; i < BYTES_FRESCURA; i++)
+    {
+      truncada = (truncada << 8) | pdu[LONGITUD_DATOS + i];
+    }
+    uint64_t valorFrescura = truncada;
+    if (BYTES_FRESCURA < 8)
+    {
+      uint64_t mascara = ((uint64_t)1 << (8 * BYTES_FRESCURA)) - 1;
+      valorFrescura = (aceptada & ~mascara) | truncada;
+      if (valorFrescura <= aceptada)
+      {
+        valorFrescura += mascara + 1;
+      }
+    }
+    else if (valorFrescura <= aceptada)
+    {
+      return false; // Frescura completa repetida o antigua
+    }
+    memset(datos, 0, LONGITUD_MENSAJE_CAN);
+    memcpy(datos, pdu, LONGITUD_DATOS);
+    calcularMAC(datos, valorFrescura, mac);
+    if (memcmp(mac, pdu + LONGITUD_DATOS + BYTES_FRESCURA, BYTES_MAC) != 0)
+    {
+      return false;
+    }
+    // Sólo un mensaje auténtico hace avanzar la frescura
+    aceptada = valorFrescura;
+    return true;
+  }
+};
+
+// Datos en claro seguidos de los BYTES_MAC primeros bytes de su AES-CMAC
+template <const uint8_t *CLAVE, uint16_t BITS, uint8_t BYTES_MAC>
+struct EsquemaCMAC
+{
+  static_assert(BYTES_MAC >= 1 && BYTES_MAC <= LONGITUD_BLOQUE_CMAC, "El MAC truncado va de 1 a 16 bytes");
+  static const uint16_t LONGITUD_PDU = LONGITUD_MENSAJE_CAN + BYTES_MAC;
+  inline static const ContextoCMAC *contexto = NULL; // Clave con las subclaves ya calculadas
+
+  static void preparar(bool emisor)
+  {
+    contexto = obtenerContextoCMAC(CLAVE, BITS);
+  }
+
+  static void proteger(const uint8_t *datos, uint8_t *pdu)
+  {
+    uint8_t mac[LONGITUD_BLOQUE_CMAC];
+    memcpy(pdu, datos, LONGITUD_MENSAJE_CAN);
+    calcularCMAC(contexto, datos, LONGITUD_MENSAJE_CAN, mac);
+    memcpy(pdu + LONGITUD_MENSAJE_CAN, mac, BYTES_MAC);
+  }
+
+  static bool verificar(const uint8_t *pdu, uint8_t *datos)
+  {
+    uint8_t mac[LONGITUD_BLOQUE_CMAC];
+    memcpy(datos, pdu, LONGITUD_MENSAJE_CAN);
+    calcularCMAC(contexto, datos, LONGITUD_MENSAJE_CAN, mac);
+    // Ahora comparamos el MAC calculado con el MAC recibido
+    return memcmp(mac, pdu + LONGITUD_MENSAJE_CAN, BYTES_MAC) == 0;
+  }
+};
+
+// Operación RSA en bruto: el emisor usa la clave privada y el receptor la pública.
+// Las claves se cargan en setup() con el almacén de claves. La operación privada va cegada
+// con el generador aleatorio y, con PARALELO, calcula las dos mitades del CRT en los dos núcleos
+template <ClaveRSA &CLAVE, uint16_t LONGITUD, bool PARALELO = false>
+struct EsquemaRSA
+{
+  static const uint16_t LONGITUD_PDU = LONGITUD;
+
+  static void preparar(bool emisor) {}
+
+  static void proteger(const uint8_t *datos, uint8_t *pdu)
+  {
+    static uint8_t entrada[LONGITUD]; // Padding con ceros ya que la entrada del cifrador es de LONGITUD bytes
+    memcpy(entrada, datos, LONGITUD_MENSAJE_CAN);
+    if (PARALELO)
+    {
+      privadaRSAParalela(CLAVE.contextoRSA, entrada, pdu);
+    }
+    else
+    {
+      mbedtls_rsa_private(CLAVE.contextoRSA, generarAleatorio, NULL, entrada, pdu);
+    }
+  }
+
+  static bool verificar(const uint8_t *pdu, uint8_t *datos)
+  {
+    static uint8_t salida[LONGITUD];
+    if (mbedtls_rsa_public(CLAVE.contextoRSA, pdu, salida) != 0)
+    {
+      return false;
+    }
+    memcpy(datos, salida, LONGITUD_MENSAJE_CAN);
+    // El padding tiene que haber vuelto a ser todo ceros
+    for (uint16_t i = LONGITUD_MENSAJE_CAN; i < LONGITUD; i++)
+    {
+      if (salida[i] != 0)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+// Algoritmos de firma de curva elíptica: cada uno indica cómo se firma y cómo se comprueba
+struct FirmaECDSA
+{
+  static bool firmar(ClaveEC &clave, const uint8_t *datos, size_t longitud, uint8_t *firma) { return firmarECDSA(clave, datos, longitud, firma); }
+  static bool verificar(ClaveEC &clave, const uint8_t *datos, size_t longitud, const uint8_t *firma) { return verificarECDSA(clave, datos, longitud, firma); }
+};
+
+struct FirmaSchnorr
+{
+  static bool firmar(ClaveEC &clave, const uint8_t *datos, size_t longitud, uint8_t *firma) { return firmarSchnorr(clave, datos, longitud, firma); }
+  static bool verificar(ClaveEC &clave, const uint8_t *datos, size_t longitud, const uint8_t *firma) { return verificarSchnorr(clave, datos, longitud, firma); }
+};
+
+// Datos en claro seguidos de una firma de 64 bytes: el emisor firma con la clave privada
+// y el receptor comprueba con la pública. Las claves se cargan en setup() con el almacén de claves
+template <ClaveEC &CLAVE, class Firma>
+struct EsquemaFirmaEC
+{
+  static const uint16_t LONGITUD_PDU = LONGITUD_MENSAJE_CAN + LONGITUD_FIRMA_EC;
+
+  static void preparar(bool emisor) {}
+
+  static void proteger(const uint8_t *datos, uint8_t *pdu)
+  {
+    memcpy(pdu, datos, LONGITUD_MENSAJE_CAN);
+    if (!Firma::firmar(CLAVE, datos, LONGITUD_MENSAJE_CAN, pdu + LONGITUD_MENSAJE_CAN))
+    {
+      memset(pdu + LONGITUD_MENSAJE_CAN, 0, LONGITUD_FIRMA_EC); // Una firma a ceros nunca es válida
+    }
+  }
+
+  static bool verificar(const uint8_t *pdu, uint8_t *datos)
+  {
+    memcpy(datos, pdu, LONGITUD_MENSAJE_CAN);
+    return Firma::verificar(CLAVE, datos, LONGITUD_MENSAJE_CAN, pdu + LONGITUD_MENSAJE_CAN);
+  }
+};
+
+#ifdef FIRMA_ED25519
+// Datos en claro seguidos de su firma Ed25519 de 64 bytes
+template <ClaveEd25519 &CLAVE>
+struct EsquemaEd25519
+{
+  static const uint16_t LONGITUD_PDU = LONGITUD_MENSAJE_CAN + 2 * LONGITUD_CLAVE_EC;
+
+  static void preparar(bool emisor) {}
+
+  static void proteger(const uint8_t *datos, uint8_t *pdu)
+  {
+    memcpy(pdu, datos, LONGITUD_MENSAJE_CAN);
+    Ed25519::sign(pdu + LONGITUD_MENSAJE_CAN, CLAVE.semilla, CLAVE.publica, datos, LONGITUD_MENSAJE_CAN);
+  }
+
+  static bool verificar(const uint8_t *pdu, uint8_t *datos)
+  {
+    memcpy(datos, pdu, LONGITUD_MENSAJE_CAN);
+    return Ed25519::verify(pdu + LONGITUD_MENSAJE_CAN, CLAVE.publica, datos, LONGITUD_MENSAJE_CAN);
+  }
+};
+#endif
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef FIRMA_EC_H
+#define FIRMA_EC_H
+
+/*
+Firmas de curva elíptica sobre P-256 con las claves del almacén.
+
+- ECDSA: firma del SHA-256 de los datos con mbedtls, serializada como r || s
+- Schnorr: EC-SDSA optimizado de ISO/IEC 14888-3. Con k aleatorio y W = k·G,
+  r = SHA-256(x(W) || datos) y s = k + r·d mod n. Se verifica recalculando
+  W = s·G - r·Q con una sola doble multiplicación y comparando el resumen.
+  No necesita inversos modulares, así que firma y verifica más rápido que ECDSA
+
+Las dos firmas miden 64 bytes, 8 tramas clásicas. El nonce de las dos sale del
+generador aleatorio, que tiene que estar sembrado antes de firmar.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include "AlmacenClaves.h"
+
+// Longitud de una firma: dos valores de 32 bytes
+const uint8_t LONGITUD_FIRMA_EC = 2 * LONGITUD_CLAVE_EC;
+
+// Firma los datos con ECDSA. Devuelve false si la firma ha fallado
+bool firmarECDSA(ClaveEC &clave, const uint8_t *datos, size_t longitud, uint8_t *firma);
+// Comprueba una firma ECDSA de los datos
+bool verificarECDSA(ClaveEC &clave, const uint8_t *datos, size_t longitud, const uint8_t *firma);
+// Firma los datos con Schnorr. Devuelve false si la firma ha fallado
+bool firmarSchnorr(ClaveEC &clave, const uint8_t *datos, size_t longitud, uint8_t *firma);
+// Comprueba una firma Schnorr de los datos
+bool verificarSchnorr(ClaveEC &clave, const uint8_t *datos, size_t longitud, const uint8_t *firma);
+
+#endif
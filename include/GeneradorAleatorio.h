@@ -0,0 +1,20 @@
+#ifndef GENERADOR_ALEATORIO_H
+#define GENERADOR_ALEATORIO_H
+
+/*
+Generador de números aleatorios para las operaciones de clave pública.
+
+Es un CTR-DRBG de mbedtls sembrado con la entropía del RNG de hardware, igual
+que en el programa de generación de claves. Se siembra una única vez en
+setup() y su función de generación tiene la firma f_rng de mbedtls, así que se
+puede pasar tal cual a las funciones de firma y de cegado.
+*/
+
+#include <stddef.h>
+
+// Siembra el generador. Devuelve false si la siembra ha fallado
+bool iniciarGeneradorAleatorio();
+// Llena salida con longitud bytes aleatorios. El contexto no se usa: se puede pasar NULL
+int generarAleatorio(void *contexto, unsigned char *salida, size_t longitud);
+
+#endif
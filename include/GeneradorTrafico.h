@@ -0,0 +1,47 @@
+#ifndef GENERADOR_TRAFICO_H
+#define GENERADOR_TRAFICO_H
+
+/*
+Generador de tráfico de fondo para medir con el bus cargado.
+
+Un tercer nodo (rol GEN en main.cpp) envía tramas periódicas o en ráfagas
+con los identificadores de una tabla de flujos. Como en CAN gana el
+arbitraje el identificador menor, los flujos con identificador menor que el
+de la medida retrasan sus tramas y los de identificador mayor sólo ocupan
+el bus entre ellas. El retraso que sufren las transferencias de varias
+tramas se ve en las estadísticas del transporte de los otros dos nodos
+("Retraso del transporte"), comparando ejecuciones con y sin generador.
+
+Las tramas se envían en su instante previsto; si la cola de transmisión no
+tiene sitio, la trama se descarta y se cuenta, así la carga ofrecida no se
+desplaza en el tiempo. Cada PERIODO_INFORME_TRAFICO se muestran las tramas
+enviadas y descartadas de cada flujo y la carga conseguida.
+*/
+
+#include <Arduino.h>
+#include <driver/twai.h>
+
+// Máximo de flujos en la tabla
+const uint8_t MAX_FLUJOS_TRAFICO = 8;
+// Tiempo entre informes, en us
+const uint64_t PERIODO_INFORME_TRAFICO = 5000000;
+// Espera máxima por sitio en la cola de transmisión para cada trama de una ráfaga
+const TickType_t ESPERA_TX_TRAFICO = pdMS_TO_TICKS(2);
+// Por debajo de este margen hasta la siguiente trama se espera activamente, en us
+const uint64_t ESPERA_ACTIVA_TRAFICO = 2000;
+
+// Flujo de tráfico: cada periodo se envían rafaga tramas seguidas con el identificador
+struct FlujoTrafico
+{
+  uint32_t identificador;
+  uint32_t periodo; // en us
+  uint8_t rafaga;   // Tramas por periodo: 1 es tráfico periódico, más es tráfico en ráfagas
+  uint8_t longitud; // Bytes de datos de cada trama
+};
+
+// Prepara los flujos y muestra la carga ofrecida de cada uno con el bitrate del bus
+bool iniciarGeneradorTrafico(const FlujoTrafico *flujos, uint8_t numeroFlujos, bool extendido, const twai_timing_config_t &tiempos);
+// Genera tráfico durante un periodo de informe y muestra el informe
+void generarTrafico();
+
+#endif
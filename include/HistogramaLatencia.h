@@ -0,0 +1,53 @@
+#ifndef HISTOGRAMA_LATENCIA_H
+#define HISTOGRAMA_LATENCIA_H
+
+/*
+Estadísticas de latencia con memoria constante.
+
+Los valores se cuentan en un histograma logarítmico al estilo HDR: hasta
+2^BITS_SUBCUBETAS_LATENCIA el valor es exacto y, por encima, cada potencia de
+dos se divide en 2^BITS_SUBCUBETAS_LATENCIA cubetas iguales, así que un
+percentil tiene un error relativo menor del 3 %. El mínimo, el máximo, la
+media y la desviación típica (Welford) son exactos. Ocupa lo mismo con 100
+muestras que con 10^6, de modo que NUM_REP no está limitado por la RAM.
+
+El resumen también se puede sacar como una línea CSV para procesarlo en el
+ordenador (host/comparador). Cada línea empieza por "CSV," para poder
+separarla del resto de la salida, y sus campos son los de CABECERA_CSV_LATENCIA.
+*/
+
+#include <stdint.h>
+
+// Cubetas por potencia de dos: 2^5 = 32
+const uint8_t BITS_SUBCUBETAS_LATENCIA = 5;
+const uint32_t SUBCUBETAS_LATENCIA = 1UL << BITS_SUBCUBETAS_LATENCIA;
+// Cubetas para valores de hasta 32 bits; los mayores se cuentan en la última
+const uint32_t CUBETAS_LATENCIA = (33 - BITS_SUBCUBETAS_LATENCIA) * SUBCUBETAS_LATENCIA;
+
+// Campos de las líneas CSV del resumen, en orden. Los tiempos van en us
+#define CABECERA_CSV_LATENCIA "CSV,cabecera,rol,esquema,magnitud,muestras,minimo,media,desviacion,p50,p90,p99,p999,maximo"
+
+struct HistogramaLatencia
+{
+  uint32_t cubetas[CUBETAS_LATENCIA];
+  uint32_t muestras;
+  uint64_t minimo;
+  uint64_t maximo;
+  double media;    // Media acumulada con el método de Welford
+  double sumaM2;   // Suma de los cuadrados de las diferencias con la media
+
+  // Deja el histograma vacío
+  void reiniciar();
+  // Cuenta una muestra
+  void anotar(uint64_t valor);
+  // Desviación típica de las muestras
+  double desviacion() const;
+  // Valor por debajo del cual queda el porcentaje indicado de las muestras (50, 99, 99.9...)
+  uint64_t percentil(double porcentaje) const;
+  // Muestra por el puerto serie el resumen y el histograma por potencias de dos
+  void mostrar(const char *nombre, const char *magnitud) const;
+  // Muestra por el puerto serie el resumen como una línea CSV
+  void exportarCSV(const char *rol, const char *nombre, const char *magnitud) const;
+};
+
+#endif
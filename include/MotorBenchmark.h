@@ -0,0 +1,451 @@
+#ifndef MOTOR_BENCHMARK_H
+#define MOTOR_BENCHMARK_H
+
+/*
+Motor de medida común a todos los esquemas.
+
+Cada esquema es una clase de política con cuatro pasos:
+- preparar(emisor): se llama una vez en setup() (claves, contextos...)
+- proteger(datos, pdu): el lado izquierdo genera la PDU a enviar a partir de los 8 bytes de datos
+- tramar: si la PDU cabe en una trama se envía tal cual; si no, el motor la envía con el
+  transporte CAN (TransporteCAN.h) y la reensambla al recibirla
+- verificar(pdu, datos): el lado derecho recupera los datos y comprueba la PDU
+
+El lado derecho no devuelve los datos: su respuesta lleva el resultado de la
+verificación, el tiempo que ha pasado desde que llegó la última trama de la
+PDU hasta que sale la respuesta y lo que ha durado verificar(). El lado
+izquierdo resta ese proceso remoto y el tiempo en el bus de la respuesta a la
+ida y vuelta, así que además del tiempo de cada iteración muestra la latencia
+de ida de la PDU (cola de transmisión, cable y recepción) y el coste de la
+verificación en el receptor.
+
+Además la política indica la longitud de la PDU en LONGITUD_PDU. El motor se
+instancia para cada esquema, así que la parte criptográfica de cada uno queda
+especializada en tiempo de compilación y todos se miden exactamente igual.
+
+Si se define MODO_CANALIZADO la criptografía y la E/S CAN van en núcleos
+distintos: una etapa criptográfica en el núcleo que no usa loop() y la etapa
+de E/S en loop(), unidas por un anillo sin bloqueos de PDUs reservadas de
+antemano. En el lado izquierdo el mensaje N+1 se protege mientras el N está
+en el bus; en el derecho la etapa de E/S recibe y la criptográfica verifica
+y responde. Tras cada esquema se muestra la ocupación de cada etapa y del
+anillo y los mensajes por segundo.
+
+Si se define MODO_CAUDAL el lado izquierdo no espera cada respuesta: envía
+mensajes a un ritmo fijo con hasta VENTANA_CAUDAL en vuelo, y el derecho
+responde a cada uno con su número de secuencia. Cada esquema se mide con
+varias cargas ofrecidas, en % de la capacidad del bus, y para cada una se
+muestran los mensajes y tramas por segundo conseguidos, la ocupación del bus
+y la latencia desde el instante previsto de cada mensaje hasta su respuesta:
+la curva de latencia frente a carga ofrecida.
+
+Con MODO_MULTINODO (TopologiaCAN.h) el lado izquierdo es cada emisor y el
+derecho cada receptor de la tabla de nodos: el emisor espera la respuesta de
+todos los receptores a los que envía y el receptor atiende los mensajes de
+todos los emisores que le envían.
+*/
+
+#include <Arduino.h>
+#include <driver/twai.h>
+#include "TrazaCiclos.h"
+#include "TopologiaCAN.h"
+
+// #define MODO_CANALIZADO // Si está definido, la criptografía y la E/S CAN van en núcleos distintos
+// #define MODO_CAUDAL // Si está definido, se mide el caudal con varios mensajes en vuelo y distintas cargas
+// #define SALIDA_CSV // Si está definido, el resumen de cada esquema sale también en líneas CSV (ver HistogramaLatencia.h)
+
+const uint8_t LONGITUD_MENSAJE_CAN = 8;
+// El lado izquierdo rellena los datos de cada mensaje con 0, 1, ..., 7. Los esquemas sin MAC
+// comprueban con esto que los datos descifrados son los enviados
+inline bool sonDatosPrueba(const uint8_t *datos)
+{
+  for (uint8_t i = 0; i < LONGITUD_MENSAJE_CAN; i++)
+  {
+    if (datos[i] != i)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+// Número de repeticiones de cada prueba. Las muestras van a un histograma de memoria constante,
+// así que se puede subir hasta millones sin que crezca la RAM
+const uint32_t NUM_REP = 100;
+
+#ifdef MODO_CANALIZADO
+// PDUs en el anillo entre las dos etapas (potencia de dos)
+const uint32_t LONGITUD_ANILLO_CANALIZACION = 4;
+// Longitud máxima de una PDU en el anillo, la de RSA-4096
+const uint16_t LONGITUD_MAXIMA_PDU_CANALIZADA = 512;
+// Prioridad de la etapa criptográfica, por encima de la reserva de flujo CTR
+const UBaseType_t PRIORIDAD_ETAPA_CRIPTO = 2;
+// Tiempo de espera activa antes de ceder el núcleo cuando el anillo está lleno o vacío, en us
+const unsigned long ESPERA_ACTIVA_CANALIZACION = 500;
+
+// PDU en el anillo entre las dos etapas, con lo que la etapa siguiente necesita
+struct PDUCanalizada
+{
+  uint8_t datos[LONGITUD_MENSAJE_CAN];
+  uint8_t pdu[LONGITUD_MAXIMA_PDU_CANALIZADA];
+  bool recibida;                 // Lado derecho: la PDU ha llegado completa
+  uint64_t instanteLlegada;      // Lado derecho: llegada de la última trama de la PDU en us
+  uint64_t tiempoOperacion;      // Lado izquierdo: tiempo de proteger() en us
+};
+#endif
+
+// Respuesta del lado derecho. Trama: estado (0x00 verificada, 0xFF error), tiempo de proceso en
+// 24 bits, tiempo de verificación en 24 bits y número de secuencia; los tiempos en us y big endian
+struct RespuestaBenchmark
+{
+  bool valida;                 // La PDU ha llegado completa y se ha verificado
+  uint32_t tiempoProceso;      // Desde la llegada de la última trama de la PDU hasta el envío de la respuesta, en us
+  uint32_t tiempoVerificacion; // Duración de verificar() en us
+  uint64_t instanteLlegada;    // Llegada de la respuesta al lado izquierdo, con su reloj, en us
+  uint8_t secuencia;           // Número de secuencia del mensaje en el modo caudal
+};
+
+#if defined(MODO_MULTINODO) && (defined(MODO_CANALIZADO) || defined(MODO_CAUDAL))
+#error "MODO_MULTINODO no se puede combinar con MODO_CANALIZADO ni con MODO_CAUDAL"
+#endif
+
+// Mensajes en vuelo como máximo en MODO_CAUDAL. Hasta 128 para que el número de secuencia de 8 bits no
+// sea ambiguo. Fuera de ese modo sólo dimensiona las tramas aplazadas del transporte (TransporteCAN.cpp)
+const uint8_t VENTANA_CAUDAL = 8;
+static_assert(VENTANA_CAUDAL >= 1 && VENTANA_CAUDAL <= 128, "La ventana va de 1 a 128 mensajes");
+
+#ifdef MODO_CAUDAL
+#ifdef MODO_CANALIZADO
+#error "MODO_CAUDAL y MODO_CANALIZADO no se pueden usar a la vez"
+#endif
+// Mensajes de cada punto de la curva
+const uint32_t MENSAJES_CAUDAL = 100;
+// Carga ofrecida de cada punto, en % de la capacidad del bus
+const uint16_t CARGAS_CAUDAL[] = {10, 25, 50, 75, 90, 100, 125};
+const uint8_t PUNTOS_CAUDAL = sizeof(CARGAS_CAUDAL) / sizeof(CARGAS_CAUDAL[0]);
+// Tiempo sin respuestas tras el que se dan por perdidos los mensajes en vuelo, en us
+const uint64_t ESPERA_MAXIMA_CAUDAL = 2000000;
+#endif
+
+// Entrada del registro de esquemas
+struct DescriptorEsquema
+{
+  const char *nombre;      // Nombre corto, por ejemplo "AES-128"
+  const char *descripcion; // Para los mensajes, por ejemplo "cifrados con AES-128"
+  uint16_t longitudPDU;     // Bytes de la PDU que envía el lado izquierdo
+  void (*preparar)(bool emisor);
+  void (*medir)(const DescriptorEsquema &esquema);
+  void (*responder)(const DescriptorEsquema &esquema);
+};
+
+// Configura el identificador con el que transmite este lado y el transporte de las PDUs
+void iniciarMotorBenchmark(uint32_t identificador, bool extendido, const twai_timing_config_t &tiempos, uint8_t tamanoBloque, uint8_t separacionMinima);
+// Envía la PDU con el transporte CAN
+void enviarPDU(const uint8_t *pdu, uint16_t longitud);
+// Recibe una PDU con el transporte CAN y deja en instanteLlegada cuándo llegó su última trama.
+// Devuelve false si no llega completa o su longitud no es la indicada
+bool recibirPDU(uint8_t *pdu, uint16_t longitud, uint64_t *instanteLlegada);
+// Nodo que envió la última PDU recibida, para los esquemas con estado por emisor (TopologiaCAN.h)
+uint8_t nodoOrigenPDU();
+// Envía la respuesta del lado derecho con el resultado de la verificación, el tiempo desde
+// instanteLlegada hasta este momento y la duración de la verificación
+void enviarRespuesta(bool valido, uint64_t instanteLlegada, uint64_t tiempoVerificacion, uint8_t secuencia = 0);
+// Espera la respuesta del lado derecho
+void recibirRespuesta(RespuestaBenchmark *respuesta);
+// Lado izquierdo: anota el tiempo de una iteración completa y el de la operación
+void anotarMedida(uint64_t tiempoTranscurrido, uint64_t tiempoOperacion);
+// Lado izquierdo: anota, con una respuesta y el instante en que empezó el envío de la PDU,
+// la latencia de ida y la verificación remota
+void anotarRespuesta(uint64_t instanteEnvio, const RespuestaBenchmark &respuesta);
+// Lado derecho: anota el tiempo de la operación
+void anotarMedidaRespuesta(uint64_t tiempoOperacion);
+// Muestra la media del envío y de la operación, su distribución y el reparto por fases, y vacía las estadísticas
+void mostrarMedidas(const DescriptorEsquema &esquema);
+// Muestra la media de la operación en el lado derecho y su distribución, y vacía las estadísticas
+void mostrarMedidasRespuesta(const DescriptorEsquema &esquema);
+
+// Lado izquierdo: protege, envía y espera la respuesta NUM_REP veces
+template <class Esquema>
+void medirEsquema(const DescriptorEsquema &esquema)
+{
+  static uint8_t pdu[Esquema::LONGITUD_PDU];
+  uint8_t datos[LONGITUD_MENSAJE_CAN];
+  RespuestaBenchmark respuesta;
+  for (uint32_t k = 0; k <= NUM_REP; k++) // Hacemos NUM_REP+1 porque la primera iteración es unos 30 us más lenta
+  {
+    // Inicio el contador
+    uint64_t tiempoInicial = micros64();
+    empezarTraza();
+    // Rellenamos el campo de datos a enviar
+    for (uint8_t i = 0; i < LONGITUD_MENSAJE_CAN; i++)
+    {
+      datos[i] = i;
+    }
+    sondaTraza(FASE_CARGA);
+    // Protegemos los datos con el esquema
+    uint64_t tiempoInicialOperacion = micros64();
+    Esquema::proteger(datos, pdu);
+    uint64_t tiempoOperacion = micros64() - tiempoInicialOperacion;
+    sondaTraza(FASE_CRIPTO);
+    // Enviamos la PDU y esperamos a que nos lleguen los mensajes de vuelta, uno por receptor
+    uint64_t instanteEnvio = micros64();
+    enviarPDU(pdu, Esquema::LONGITUD_PDU);
+    for (uint8_t r = 0; r < receptoresTopologiaCAN(); r++)
+    {
+      recibirRespuesta(&respuesta);
+      if (k > 0)
+      {
+        anotarRespuesta(instanteEnvio, respuesta);
+      }
+    }
+    // Tiempo empleado en el proceso
+    uint64_t tiempoFinal = micros64();
+    if (k > 0)
+    {
+      anotarMedida(tiempoFinal - tiempoInicial, tiempoOperacion);
+    }
+  }
+  terminarEsquemaTopologiaCAN();
+  mostrarMedidas(esquema);
+}
+
+// Lado derecho: recibe, verifica y responde NUM_REP veces a cada emisor
+template <class Esquema>
+void responderEsquema(const DescriptorEsquema &esquema)
+{
+  static uint8_t pdu[Esquema::LONGITUD_PDU];
+  uint8_t datos[LONGITUD_MENSAJE_CAN];
+  const uint32_t mensajes = (NUM_REP + 1) * emisoresTopologiaCAN();
+  for (uint32_t k = 0; k < mensajes; k++) // Hacemos NUM_REP+1 porque la primera iteración es unos 30 us más lenta
+  {
+    empezarTraza();
+    // Esperamos a que nos lleguen todos los mensajes de la PDU
+    uint64_t instanteLlegada;
+    bool recibida = recibirPDU(pdu, Esquema::LONGITUD_PDU, &instanteLlegada);
+    // Recuperamos los datos y comprobamos la PDU
+    uint64_t tiempoInicialOperacion = micros64();
+    bool valido = recibida && Esquema::verificar(pdu, datos);
+    uint64_t tiempoOperacion = micros64() - tiempoInicialOperacion;
+    sondaTraza(FASE_VERIFICACION);
+    // Respondemos con el resultado y lo que hemos tardado
+    enviarRespuesta(valido, instanteLlegada, tiempoOperacion);
+    if (k >= emisoresTopologiaCAN()) // No se cuentan las primeras, tantas como emisores
+    {
+      anotarMedidaRespuesta(tiempoOperacion);
+    }
+  }
+  terminarEsquemaTopologiaCAN();
+  mostrarMedidasRespuesta(esquema);
+}
+
+#ifdef MODO_CANALIZADO
+// Arranca la tarea de la etapa criptográfica en el núcleo indicado
+bool iniciarCanalizacion(BaseType_t nucleo);
+// Encarga una etapa a la tarea criptográfica y vuelve inmediatamente
+void lanzarEtapaCripto(void (*etapa)());
+// Espera a que la etapa criptográfica termine
+void esperarEtapaCripto();
+// Productor: hueco libre del anillo, esperando si está lleno
+PDUCanalizada *reservarPDUCanalizada();
+// Productor: pasa el hueco a la otra etapa
+void publicarPDUCanalizada();
+// Consumidor: PDU más antigua del anillo, esperando si está vacío
+PDUCanalizada *siguientePDUCanalizada();
+// Consumidor: devuelve el hueco al productor
+void liberarPDUCanalizada();
+// Suma el tiempo que la etapa criptográfica ha estado trabajando
+void sumarTiempoEtapaCripto(uint64_t tiempo);
+// Marca el comienzo y el final de la medida de un esquema canalizado
+void empezarCanalizacion();
+void terminarCanalizacion();
+// Muestra la ocupación de las etapas y del anillo y los mensajes por segundo
+void mostrarEstadisticasCanalizacion(const char *nombre, bool emisor);
+
+// Etapa criptográfica del lado izquierdo: protege los mensajes por delante de la E/S
+template <class Esquema>
+void protegerCanalizado()
+{
+  static_assert(Esquema::LONGITUD_PDU <= LONGITUD_MAXIMA_PDU_CANALIZADA, "La PDU no cabe en el anillo");
+  for (uint32_t k = 0; k <= NUM_REP; k++)
+  {
+    PDUCanalizada *hueco = reservarPDUCanalizada();
+    uint64_t tiempoInicial = micros64();
+    empezarTraza();
+    // Rellenamos el campo de datos a enviar
+    for (uint8_t i = 0; i < LONGITUD_MENSAJE_CAN; i++)
+    {
+      hueco->datos[i] = i;
+    }
+    sondaTraza(FASE_CARGA);
+    uint64_t tiempoInicialOperacion = micros64();
+    Esquema::proteger(hueco->datos, hueco->pdu);
+    hueco->tiempoOperacion = micros64() - tiempoInicialOperacion;
+    sondaTraza(FASE_CRIPTO);
+    sumarTiempoEtapaCripto(micros64() - tiempoInicial);
+    publicarPDUCanalizada();
+  }
+}
+
+// Lado izquierdo canalizado: la etapa de E/S envía cada PDU ya protegida y espera la respuesta
+template <class Esquema>
+void medirEsquemaCanalizado(const DescriptorEsquema &esquema)
+{
+  RespuestaBenchmark respuesta;
+  empezarCanalizacion();
+  lanzarEtapaCripto(&protegerCanalizado<Esquema>);
+  for (uint32_t k = 0; k <= NUM_REP; k++) // Hacemos NUM_REP+1 porque la primera iteración es unos 30 us más lenta
+  {
+    PDUCanalizada *pdu = siguientePDUCanalizada();
+    uint64_t tiempoInicial = micros64();
+    empezarTraza();
+    // Mientras esta PDU está en el bus, la etapa criptográfica ya protege la siguiente
+    enviarPDU(pdu->pdu, Esquema::LONGITUD_PDU);
+    uint64_t tiempoOperacion = pdu->tiempoOperacion;
+    liberarPDUCanalizada();
+    recibirRespuesta(&respuesta);
+    if (k > 0)
+    {
+      anotarMedida(micros64() - tiempoInicial, tiempoOperacion);
+      anotarRespuesta(tiempoInicial, respuesta);
+    }
+  }
+  esperarEtapaCripto();
+  terminarCanalizacion();
+  mostrarMedidas(esquema);
+  mostrarEstadisticasCanalizacion(esquema.nombre, true);
+}
+
+// Etapa criptográfica del lado derecho: verifica lo que recibe la E/S y responde.
+// Es la única que anota medidas mientras dura el esquema
+template <class Esquema>
+void verificarCanalizado()
+{
+  uint8_t datos[LONGITUD_MENSAJE_CAN];
+  for (uint32_t k = 0; k <= NUM_REP; k++)
+  {
+    PDUCanalizada *pdu = siguientePDUCanalizada();
+    uint64_t tiempoInicialOperacion = micros64();
+    empezarTraza();
+    bool valido = pdu->recibida && Esquema::verificar(pdu->pdu, datos);
+    uint64_t tiempoOperacion = micros64() - tiempoInicialOperacion;
+    sondaTraza(FASE_VERIFICACION);
+    uint64_t instanteLlegada = pdu->instanteLlegada;
+    liberarPDUCanalizada();
+    // La respuesta sale desde esta etapa, así la E/S ya puede estar recibiendo la siguiente PDU.
+    // El proceso remoto incluye el tiempo que la PDU ha esperado en el anillo
+    enviarRespuesta(valido, instanteLlegada, tiempoOperacion);
+    sumarTiempoEtapaCripto(tiempoOperacion);
+    if (k > 0)
+    {
+      anotarMedidaRespuesta(tiempoOperacion);
+    }
+  }
+}
+
+// Lado derecho canalizado: la etapa de E/S recibe las PDUs en el anillo
+template <class Esquema>
+void responderEsquemaCanalizado(const DescriptorEsquema &esquema)
+{
+  static_assert(Esquema::LONGITUD_PDU <= LONGITUD_MAXIMA_PDU_CANALIZADA, "La PDU no cabe en el anillo");
+  empezarCanalizacion();
+  lanzarEtapaCripto(&verificarCanalizado<Esquema>);
+  for (uint32_t k = 0; k <= NUM_REP; k++)
+  {
+    PDUCanalizada *hueco = reservarPDUCanalizada();
+    empezarTraza();
+    // Esperamos a que nos lleguen todos los mensajes de la PDU
+    hueco->recibida = recibirPDU(hueco->pdu, Esquema::LONGITUD_PDU, &hueco->instanteLlegada);
+    publicarPDUCanalizada();
+  }
+  esperarEtapaCripto();
+  terminarCanalizacion();
+  mostrarMedidasRespuesta(esquema);
+  mostrarEstadisticasCanalizacion(esquema.nombre, false);
+}
+#endif
+
+#ifdef MODO_CAUDAL
+// Envía una PDU y espera su respuesta para conocer el tiempo de un mensaje en el bus, el 100 % de carga
+void calibrarCaudal(const DescriptorEsquema &esquema, const uint8_t *pdu, uint16_t longitud);
+// Empieza un punto de la curva y devuelve el periodo entre mensajes de su carga ofrecida, en us
+uint64_t empezarPuntoCaudal(uint16_t carga);
+// Atiende las respuestas hasta el instante indicado y hasta que haya sitio en la ventana
+void esperarTurnoCaudal(uint64_t instante);
+// Apunta el instante previsto del siguiente mensaje, que es desde donde se mide su latencia
+void anotarEnvioCaudal(uint64_t instantePrevisto);
+// Espera las respuestas que faltan y muestra el punto
+void terminarPuntoCaudal(const DescriptorEsquema &esquema, uint16_t carga);
+
+// Lado izquierdo en modo caudal: para cada carga envía MENSAJES_CAUDAL mensajes a ritmo fijo sin
+// esperar cada respuesta, con hasta VENTANA_CAUDAL en vuelo
+template <class Esquema>
+void medirCaudal(const DescriptorEsquema &esquema)
+{
+  static uint8_t pdu[Esquema::LONGITUD_PDU];
+  uint8_t datos[LONGITUD_MENSAJE_CAN];
+  for (uint8_t i = 0; i < LONGITUD_MENSAJE_CAN; i++)
+  {
+    datos[i] = i;
+  }
+  // Un primer mensaje con respuesta da el tiempo de un mensaje en el bus, el 100 % de carga
+  Esquema::proteger(datos, pdu);
+  calibrarCaudal(esquema, pdu, Esquema::LONGITUD_PDU);
+  for (uint8_t punto = 0; punto < PUNTOS_CAUDAL; punto++)
+  {
+    uint64_t periodo = empezarPuntoCaudal(CARGAS_CAUDAL[punto]);
+    uint64_t instantePrevisto = micros64();
+    for (uint32_t k = 0; k < MENSAJES_CAUDAL; k++)
+    {
+      esperarTurnoCaudal(instantePrevisto);
+      anotarEnvioCaudal(instantePrevisto);
+      instantePrevisto += periodo;
+      // Rellenamos el campo de datos a enviar
+      for (uint8_t i = 0; i < LONGITUD_MENSAJE_CAN; i++)
+      {
+        datos[i] = i;
+      }
+      Esquema::proteger(datos, pdu);
+      enviarPDU(pdu, Esquema::LONGITUD_PDU);
+    }
+    terminarPuntoCaudal(esquema, CARGAS_CAUDAL[punto]);
+  }
+}
+
+// Lado derecho en modo caudal: verifica y responde cada mensaje con su número de secuencia
+template <class Esquema>
+void responderCaudal(const DescriptorEsquema &esquema)
+{
+  static uint8_t pdu[Esquema::LONGITUD_PDU];
+  uint8_t datos[LONGITUD_MENSAJE_CAN];
+  // El mensaje de calibración y después los de cada punto, numerados desde cero en cada uno
+  for (uint8_t punto = 0; punto <= PUNTOS_CAUDAL; punto++)
+  {
+    uint32_t mensajes = punto == 0 ? 1 : MENSAJES_CAUDAL;
+    for (uint32_t k = 0; k < mensajes; k++)
+    {
+      uint64_t instanteLlegada;
+      bool recibida = recibirPDU(pdu, Esquema::LONGITUD_PDU, &instanteLlegada);
+      uint64_t tiempoInicialOperacion = micros64();
+      bool valido = recibida && Esquema::verificar(pdu, datos);
+      uint64_t tiempoOperacion = micros64() - tiempoInicialOperacion;
+      enviarRespuesta(valido, instanteLlegada, tiempoOperacion, k);
+      anotarMedidaRespuesta(tiempoOperacion);
+    }
+  }
+  mostrarMedidasRespuesta(esquema);
+}
+#endif
+
+// Crea la entrada del registro para un esquema
+template <class Esquema>
+DescriptorEsquema describirEsquema(const char *nombre, const char *descripcion)
+{
+#if defined(MODO_CANALIZADO)
+  return {nombre, descripcion, Esquema::LONGITUD_PDU, &Esquema::preparar, &medirEsquemaCanalizado<Esquema>, &responderEsquemaCanalizado<Esquema>};
+#elif defined(MODO_CAUDAL)
+  return {nombre, descripcion, Esquema::LONGITUD_PDU, &Esquema::preparar, &medirCaudal<Esquema>, &responderCaudal<Esquema>};
+#else
+  return {nombre, descripcion, Esquema::LONGITUD_PDU, &Esquema::preparar, &medirEsquema<Esquema>, &responderEsquema<Esquema>};
+#endif
+}
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef MOTOR_CMAC_H
+#define MOTOR_CMAC_H
+
+/*
+Motor de autenticación AES-CMAC (RFC 4493).
+
+Usa el contexto de cifrado de la caché AES, así que la expansión de la clave
+se comparte con el resto de esquemas AES, y calcula las subclaves K1 y K2 una
+única vez por clave. En régimen permanente un MAC de una carga de hasta 16
+bytes cuesta una sola operación de bloque, y hasta 64 bytes, cuatro.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mbedtls/aes.h>
+
+const uint8_t LONGITUD_BLOQUE_CMAC = 16;
+// Número máximo de claves con subclaves calculadas
+const uint8_t MAX_CONTEXTOS_CMAC = 4;
+
+// Clave lista para calcular MACs
+struct ContextoCMAC
+{
+  const uint8_t *clave;             // La clave se identifica por su dirección
+  uint16_t bits;                    // Longitud de la clave en bits
+  mbedtls_aes_context *cifrador;    // Contexto de cifrado de la caché AES
+  uint8_t k1[LONGITUD_BLOQUE_CMAC]; // Subclave para el último bloque completo
+  uint8_t k2[LONGITUD_BLOQUE_CMAC]; // Subclave para el último bloque con relleno
+  unsigned long tiempoSubclaves;    // Tiempo de cálculo de K1 y K2 en us
+};
+
+// Devuelve el contexto de la clave con las subclaves ya calculadas, creándolo si no existe.
+// Devuelve NULL si no quedan contextos o la caché AES no tiene sitio
+const ContextoCMAC *obtenerContextoCMAC(const uint8_t *clave, uint16_t bits);
+// Calcula el MAC completo de 16 bytes de la carga en una sola llamada
+void calcularCMAC(const ContextoCMAC *contexto, const uint8_t *datos, size_t longitud, uint8_t *mac);
+// Muestra por el puerto serie el coste del cálculo de las subclaves de cada clave
+void mostrarCosteCMAC();
+
+#endif
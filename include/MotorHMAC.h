@@ -0,0 +1,51 @@
+#ifndef MOTOR_HMAC_H
+#define MOTOR_HMAC_H
+
+/*
+Motor de autenticación HMAC (RFC 2104) con las funciones SHA de mbedtls.
+
+HMAC(K, m) = H((K ^ opad) || H((K ^ ipad) || m)). Los bloques K ^ ipad y
+K ^ opad sólo dependen de la clave, así que se resumen una única vez por clave
+y se guardan los dos estados intermedios. En cada mensaje se clonan: el MAC de
+los 8 bytes de datos cuesta una compresión para el resumen interno y otra para
+el externo, en lugar de las cuatro de mbedtls_md_hmac_starts(), que vuelve a
+resumir los dos bloques de la clave en cada mensaje.
+
+mostrarCosteHMAC() mide además el MAC de 8 bytes con y sin los estados
+precalculados, para ver lo que se ahorra con cada función resumen.
+*/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mbedtls/md.h>
+
+// Número máximo de claves con los estados intermedios calculados
+const uint8_t MAX_CONTEXTOS_HMAC = 8;
+// Mensajes con los que mostrarCosteHMAC() mide el coste por mensaje
+const uint16_t REPETICIONES_COSTE_HMAC = 1000;
+
+// Clave lista para calcular MACs
+struct ContextoHMAC
+{
+  const uint8_t *clave;           // La clave se identifica por su dirección, su longitud y el resumen
+  uint8_t longitudClave;          // Longitud de la clave en bytes; las más largas que el bloque se resumen antes
+  mbedtls_md_type_t tipo;         // Función resumen
+  uint8_t longitudResumen;        // Bytes del resumen, que son los del MAC
+  mbedtls_md_context_t interno;   // Estado tras resumir K ^ ipad
+  mbedtls_md_context_t externo;   // Estado tras resumir K ^ opad
+  mbedtls_md_context_t trabajo;   // Donde se clonan los estados en cada mensaje
+  mbedtls_md_context_t completo;  // HMAC de mbedtls, que carga la clave en cada mensaje (sin precálculo)
+  unsigned long tiempoPrecalculo; // Tiempo de cálculo de los dos estados intermedios en us
+};
+
+// Devuelve el contexto de la clave con los estados intermedios ya calculados, creándolo si no existe.
+// Devuelve NULL si no quedan contextos o mbedtls no tiene memoria
+ContextoHMAC *obtenerContextoHMAC(mbedtls_md_type_t tipo, const uint8_t *clave, uint8_t longitudClave);
+// Calcula el MAC completo clonando los estados intermedios. mac tiene que tener sitio para MBEDTLS_MD_MAX_SIZE bytes
+void calcularHMAC(ContextoHMAC *contexto, const uint8_t *datos, size_t longitud, uint8_t *mac);
+// Calcula el mismo MAC cargando la clave en cada mensaje, como mbedtls_md_hmac(), para comparar
+void calcularHMACSinPrecalculo(ContextoHMAC *contexto, const uint8_t *datos, size_t longitud, uint8_t *mac);
+// Muestra por el puerto serie el coste del precálculo de cada clave y el de un MAC de 8 bytes con y sin él
+void mostrarCosteHMAC();
+
+#endif
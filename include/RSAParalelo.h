@@ -0,0 +1,32 @@
+#ifndef RSA_PARALELO_H
+#define RSA_PARALELO_H
+
+/*
+Operación privada RSA con las dos mitades del CRT en núcleos distintos.
+
+mbedtls_rsa_private calcula T^DP mod P y T^DQ mod Q una detrás de otra en el
+mismo núcleo, y son casi todo el coste de la operación. Aquí la mitad de P se
+encarga a una tarea en el otro núcleo mientras la de Q se calcula en el que
+llama, y después se recombinan con Garner. Las contramedidas son las mismas
+que las de mbedtls con generador: cegado de la base con el par (Vi, Vf) del
+contexto, que comparte con mbedtls_rsa_private, cegado de los exponentes y
+comprobación del resultado con la clave pública.
+
+Con el acelerador RSA por hardware (CONFIG_MBEDTLS_HARDWARE_MPI) las dos
+exponenciaciones se reparten el mismo periférico, que está protegido por un
+cerrojo, así que sólo se solapan con la implementación por software.
+*/
+
+#include <Arduino.h>
+#include <mbedtls/rsa.h>
+
+// Prioridad de la tarea de la mitad remota, por encima de la etapa criptográfica y de la reserva CTR
+const UBaseType_t PRIORIDAD_TAREA_RSA = 3;
+
+// Arranca la tarea que calcula la mitad de P en el núcleo indicado
+bool iniciarRSAParalelo(BaseType_t nucleo);
+// Operación privada como mbedtls_rsa_private, con las dos mitades a la vez. Usa el generador
+// aleatorio para el cegado. Si la tarea no está arrancada calcula las dos mitades seguidas
+int privadaRSAParalela(mbedtls_rsa_context *contexto, const unsigned char *entrada, unsigned char *salida);
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef RECEPTOR_CAN_H
+#define RECEPTOR_CAN_H
+
+/*
+Recepción de mensajes CAN.
+
+Por defecto una tarea dedicada se queda bloqueada en el driver TWAI y entrega
+cada mensaje recibido a través de una cola de FreeRTOS, de forma que quien
+espera un mensaje cede la CPU en lugar de hacer espera activa. El driver deja
+cada mensaje en un hueco de un anillo reservado de antemano y por la cola
+sólo pasa el índice del hueco, así que leerMensajeCAN() entrega el mensaje
+sin copiarlo; recibirMensajeCAN() lo copia donde se le indique.
+
+Si se define RECEPCION_POR_SONDEO se usa el bucle original
+while (twai_receive(..., 0) != ESP_OK), útil para comparar ambos métodos.
+*/
+
+#include <Arduino.h>
+#include <driver/twai.h>
+
+// #define RECEPCION_POR_SONDEO // Si está definido, se recibe con espera activa como en la versión original
+
+// Longitud de la cola entre la tarea receptora y los consumidores (cabe un mensaje RSA-4096 completo)
+const UBaseType_t LONGITUD_COLA_RECEPCION = 128;
+// Prioridad de la tarea receptora, por encima de la de loop() para despertar en cuanto llega un mensaje
+const UBaseType_t PRIORIDAD_TAREA_RECEPCION = 10;
+// Espera máxima de la tarea receptora en el driver o con la cola llena, tras la que mira si se ha pedido una pausa
+const TickType_t ESPERA_TAREA_RECEPCION = pdMS_TO_TICKS(100);
+
+// Estadísticas de la recepción desde el último reinicio
+struct EstadisticasReceptorCAN
+{
+  uint32_t mensajes;                // Mensajes entregados
+  uint64_t tiempoCedido;            // Tiempo bloqueado esperando mensajes, CPU libre para otras tareas, en us
+  uint64_t tiempoEsperaActiva;      // Tiempo consumido en espera activa en us (sólo en modo sondeo)
+  uint64_t sumatorioLatencia;       // Suma de la latencia de despertar en us
+  unsigned long latenciaMaxima;     // Latencia de despertar máxima en us
+  uint32_t sondeos;                 // Llamadas a twai_receive sin mensaje (sólo en modo sondeo)
+};
+
+// Arranca la recepción. En modo tarea crea la tarea receptora en el núcleo indicado
+bool iniciarReceptorCAN(BaseType_t nucleo);
+// Espera un mensaje CAN como mucho el tiempo indicado y lo devuelve sin copiarlo, o NULL si no llega.
+// El mensaje es válido hasta la siguiente lectura
+const twai_message_t *leerMensajeCAN(TickType_t espera = portMAX_DELAY);
+// Espera un mensaje CAN como mucho el tiempo indicado y lo copia. Devuelve true si se ha recibido
+bool recibirMensajeCAN(twai_message_t *mensaje, TickType_t espera = portMAX_DELAY);
+// Instante en us (micros64) en que llegó del driver el último mensaje entregado por leerMensajeCAN.
+// En modo tarea lo anota la tarea receptora, así que no incluye la latencia de despertar
+uint64_t instanteLlegadaCAN();
+// Filtro por software además del del TWAI: los mensajes para los que devuelve false no se
+// entregan. En modo tarea lo llama la tarea receptora. Con NULL se entregan todos
+void filtrarMensajesCAN(bool (*aceptar)(const twai_message_t &mensaje));
+// Saca a la tarea receptora del driver y descarta los mensajes pendientes, para poder
+// reinstalar el driver (BarridoBitrate.h). reanudarReceptorCAN() vuelve a recibir
+void pausarReceptorCAN();
+void reanudarReceptorCAN();
+// Pone a cero las estadísticas
+void reiniciarEstadisticasReceptorCAN();
+// Devuelve las estadísticas acumuladas
+const EstadisticasReceptorCAN &obtenerEstadisticasReceptorCAN();
+// Muestra por el puerto serie la CPU cedida y la latencia de despertar
+void mostrarEstadisticasReceptorCAN(const char *nombre);
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef RESERVA_FLUJO_CTR_H
+#define RESERVA_FLUJO_CTR_H
+
+/*
+Reserva de flujo de cifrado AES-CTR calculado de antemano.
+
+En modo contador el flujo de cifrado de los próximos mensajes se conoce antes
+de que lleguen los datos. Una tarea de baja prioridad en el núcleo que no usa
+loop() va rellenando, para cada flujo (clave, identificador CAN y dominio), un anillo
+sin bloqueos con los bloques de los contadores siguientes. En el camino
+crítico cifrar o descifrar un mensaje es sacar un bloque del anillo y hacer
+un XOR de 8 bytes; si el bloque no está (fallo) se calcula en el momento.
+*/
+
+#include <Arduino.h>
+#include <mbedtls/aes.h>
+#include "CifradoCTR.h"
+
+// Bloques calculados de antemano por flujo (potencia de dos)
+const uint32_t LONGITUD_RESERVA_CTR = 32;
+// Número máximo de flujos (clave, identificador CAN y dominio)
+const uint8_t MAX_FLUJOS_CTR = 4;
+// Prioridad de la tarea que rellena la reserva, por debajo de loop() y de la recepción
+const UBaseType_t PRIORIDAD_TAREA_RESERVA = 1;
+
+// Estadísticas del uso de la reserva desde el último reinicio
+struct EstadisticasReservaCTR
+{
+  uint32_t aciertos;    // Mensajes con el flujo ya calculado
+  uint32_t fallos;      // Mensajes en los que hubo que calcularlo en el momento
+  uint32_t descartados; // Bloques calculados que no se llegaron a usar
+};
+
+// Registra un flujo que empieza en el contador indicado. Hay que hacerlo antes de iniciar la reserva.
+// Devuelve el índice del flujo o -1 si no quedan flujos libres
+int8_t registrarFlujoCTR(mbedtls_aes_context *cifrador, uint32_t identificador, uint8_t dominio, uint64_t contadorInicial);
+// Arranca la tarea que rellena la reserva en el núcleo indicado
+bool iniciarReservaCTR(BaseType_t nucleo);
+// salida = entrada XOR flujo del contador, con el bloque de la reserva si está o calculándolo si no
+void aplicarFlujoReservaCTR(int8_t flujo, uint64_t contador, const uint8_t *entrada, uint8_t *salida, uint8_t longitud);
+// Pone a cero las estadísticas
+void reiniciarEstadisticasReservaCTR();
+// Devuelve las estadísticas acumuladas
+const EstadisticasReservaCTR &obtenerEstadisticasReservaCTR();
+// Muestra por el puerto serie los aciertos y fallos de la reserva, si se ha usado
+void mostrarEstadisticasReservaCTR(const char *nombre);
+
+#endif
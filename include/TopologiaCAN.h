@@ -0,0 +1,105 @@
+#ifndef TOPOLOGIA_CAN_H
+#define TOPOLOGIA_CAN_H
+
+/*
+Topología de varios nodos en el mismo bus.
+
+Sin MODO_MULTINODO hay dos nodos fijos: el izquierdo transmite en
+idCanTransmiteIzq y el derecho en idCanTransmiteDer. Si se define
+MODO_MULTINODO cada nodo sale de una tabla de nodos (NODOS_CAN en main.cpp)
+con su bloque de IDS_POR_NODO_CAN identificadores y su papel, emisor o
+receptor. El nodo o envía al nodo d con el identificador bloque(o) + d, a
+todos los del otro papel con bloque(o) + DESTINO_DIFUSION_CAN y las tramas de
+sincronización con bloque(o) + DESTINO_CONTROL_CAN, así que el arbitraje
+favorece a los nodos con el bloque más bajo.
+
+Se pueden medir dos patrones, según los papeles de los nodos activos:
+- Uno a varios: un emisor envía cada PDU por difusión y cada receptor la
+  verifica y responde. Sólo el primer receptor envía los controles de flujo
+  del transporte; los demás escuchan. El emisor espera todas las respuestas.
+- Varios a uno: cada emisor envía sus PDUs al único receptor, que las
+  reensambla de una en una (las tramas de otro emisor que llegan durante una
+  transferencia se aplazan, y el control de flujo las retiene) y responde a
+  cada emisor.
+Con dos nodos los dos patrones son el benchmark original.
+
+Los esquemas con estado llevan uno por emisor, indexado por su nodo: el
+contador de AES-CTR y la frescura de SecOC. El emisor usa el de su propio
+nodo y el receptor el del nodo que envió la PDU, que sale del identificador
+con el que llegó. En AES-CTR el nonce se forma con el bloque del emisor en
+lugar de idCanTransmiteIzq, así que cada emisor cifra con su propio flujo.
+
+El filtro del TWAI acepta todos los bloques de la tabla y la topología
+descarta en la tarea receptora lo que no va a este nodo, como haría una ECU
+que escucha muchos identificadores. Al final de cada esquema los emisores
+envían una trama de fin y esperan a que los receptores, cuando han recibido
+el fin de todos los emisores, los liberen; así ningún emisor empieza el
+esquema siguiente mientras un receptor sigue en el anterior.
+
+El nodo de cada programa y el número de nodos activos se fijan en main.cpp;
+en Linux se pueden cambiar al arrancar con las variables de entorno NODO_CAN
+y NODOS_CAN, así que N procesos del mismo ejecutable forman un bus de N ECUs.
+*/
+
+#include <Arduino.h>
+#include <driver/twai.h>
+
+// #define MODO_MULTINODO // Si está definido, el nodo y su papel salen de la tabla de nodos de main.cpp
+
+// Nodos como máximo en la tabla
+const uint8_t MAX_NODOS_CAN = 16;
+// Identificadores del bloque de cada nodo: uno por destino, la difusión y el control
+const uint32_t IDS_POR_NODO_CAN = 32;
+const uint8_t DESTINO_DIFUSION_CAN = 16;
+const uint8_t DESTINO_CONTROL_CAN = 17;
+
+// Papel de un nodo
+enum RolNodoCAN : uint8_t
+{
+  NODO_EMISOR,  // Protege y envía PDUs, como el lado izquierdo
+  NODO_RECEPTOR // Verifica y responde, como el lado derecho
+};
+
+// Entrada de la tabla de nodos
+struct NodoCAN
+{
+  uint32_t bloque; // Primer identificador del bloque del nodo
+  RolNodoCAN rol;
+};
+
+#ifdef MODO_MULTINODO
+// Comprueba la tabla con los numeroNodos primeros nodos activos y fija el nodo de este programa,
+// que tiene que tener en la tabla el papel con el que se ha compilado
+bool iniciarTopologiaCAN(const NodoCAN *nodos, uint8_t numeroNodos, uint8_t local, RolNodoCAN rolLocal, bool extendido);
+// En Linux, el valor de la variable de entorno indicada si existe; en la placa, siempre porDefecto
+uint8_t parametroTopologiaCAN(const char *variable, uint8_t porDefecto);
+// Identificador y bits que tienen que coincidir para que el filtro del TWAI acepte los bloques de todos los nodos
+void filtroTopologiaCAN(uint32_t *identificador, uint32_t *bitsFijos);
+// Identificador con el que este nodo envía sus PDUs: por difusión si hay varios receptores
+uint32_t identificadorDestinoCAN();
+// Identificador con el que se responde a quien envió un mensaje con el identificador recibido
+uint32_t identificadorRespuestaCAN(uint32_t recibido);
+// Emisores y receptores activos
+uint8_t emisoresTopologiaCAN();
+uint8_t receptoresTopologiaCAN();
+// Nodo de este programa en la tabla
+uint8_t nodoLocalTopologiaCAN();
+// Nodo en cuyo bloque está el identificador recibido, es decir, quien lo envió
+uint8_t nodoOrigenTopologiaCAN(uint32_t recibido);
+// Primer emisor activo de la tabla, el único en el patrón uno a varios
+uint8_t primerEmisorTopologiaCAN();
+// Primer identificador del bloque del nodo
+uint32_t bloqueNodoTopologiaCAN(uint8_t nodo);
+// Sincroniza el final de un esquema entre emisores y receptores
+void terminarEsquemaTopologiaCAN();
+#else
+inline uint8_t emisoresTopologiaCAN() { return 1; }
+inline uint8_t receptoresTopologiaCAN() { return 1; }
+// Sin tabla de nodos el único emisor es el nodo 0, así que el estado por emisor tiene una sola entrada en uso
+inline uint8_t nodoLocalTopologiaCAN() { return 0; }
+inline uint8_t nodoOrigenTopologiaCAN(uint32_t recibido) { return 0; }
+inline uint8_t primerEmisorTopologiaCAN() { return 0; }
+inline void terminarEsquemaTopologiaCAN() {}
+#endif
+
+#endif
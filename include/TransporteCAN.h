@@ -0,0 +1,167 @@
+#ifndef TRANSPORTE_CAN_H
+#define TRANSPORTE_CAN_H
+
+/*
+Transporte de PDUs de cualquier longitud sobre CAN al estilo ISO-TP (ISO 15765-2).
+
+- Trama única (SF): PDUs de hasta 7 bytes en un solo mensaje
+- Primera trama (FF) + tramas consecutivas (CF): el resto de PDUs, con número
+  de secuencia de 4 bits en cada CF
+- Control de flujo (FC): el receptor indica cuántas CF se le pueden enviar
+  seguidas (tamaño de bloque, 0 = todas) y la separación mínima entre ellas
+
+La PDU se reensambla directamente donde la quiere quien la recibe (o en un
+buffer reservado de antemano), sin reservar memoria durante la medida: cada
+trama se copia una sola vez, del hueco donde la dejó el driver
+(ReceptorCAN.h) a su posición en la PDU. Al enviar, cada trama se arma en el
+mensaje que se pasa al driver, que es lo que pide twai_transmit(); la
+cabecera de cada trama impide que la salida del esquema sea directamente el
+campo de datos de las tramas. Cada transferencia deja el número de tramas, el
+tiempo que ha durado y el tiempo mínimo que ocupa en el bus, para poder ajustar
+el tamaño de bloque y la separación en las transferencias grandes (RSA-4096).
+De las transferencias de varias tramas se guarda además el retraso sobre el
+tiempo mínimo en el bus, que crece cuando otros nodos ganan el arbitraje
+(ver GeneradorTrafico.h).
+
+Cuando varios emisores envían al mismo receptor (TopologiaCAN.h), el
+receptor reensambla las PDUs de una en una: las tramas de otro identificador
+que llegan en medio de una transferencia se aplazan y se entregan después,
+y como su emisor espera el control de flujo no llegan más. Caben las de todos
+los nodos de la tabla con VENTANA_CAUDAL mensajes en vuelo cada uno; las que no
+caben se descartan y se cuentan aparte de las aplazadas.
+
+Las tramas se envían en ráfaga: setup() dimensiona la cola de transmisión del
+driver para las tramas de la PDU más larga (tramasTransporteCAN()), así que
+cada trama se encola sin esperar y sólo si otro ha llenado la cola se espera a
+que haya hueco. El final de la transmisión se notifica una sola vez por PDU,
+con la alerta TWAI_ALERT_TX_IDLE del driver (esperarFinTransmisionCAN()), en
+lugar de consultar el estado del driver trama a trama. Tras cada esquema se
+muestra lo que cuesta encolar cada trama consecutiva, el tiempo desde que se
+empieza a encolar la última ráfaga de cada PDU hasta que el controlador la ha
+transmitido y, en el lado que recibe, el hueco entre tramas consecutivas
+seguidas en el bus: el tiempo entre llegadas menos el tiempo mínimo en el bus
+de la trama. Si se define
+ENVIO_TRAMA_A_TRAMA cada trama se encola esperando a que quepa en la cola por
+defecto del driver, como en la versión original, para comparar.
+
+Si se define TRAMADO_DIRECTO se trocea la PDU en mensajes de 8 bytes sin
+cabeceras ni control de flujo, como en la versión original, para comparar.
+
+Si se define CAN_FD las tramas son CAN FD de hasta 64 bytes: la trama única
+lleva hasta 62 bytes, la primera trama 62 y cada consecutiva 63, y la longitud
+de cada trama se redondea a la longitud válida de FD inmediatamente superior.
+El TWAI del ESP32 no admite CAN FD, así que sólo está disponible con el
+sustituto de SocketCAN de la carpeta host/.
+*/
+
+#include <Arduino.h>
+#include <driver/twai.h>
+#include "HistogramaLatencia.h"
+
+// #define TRAMADO_DIRECTO // Si está definido, la PDU va troceada sin cabeceras como en la versión original
+// #define CAN_FD // Si está definido, se usan tramas CAN FD de 64 bytes (sólo con el sustituto de Linux)
+// #define ENVIO_TRAMA_A_TRAMA // Si está definido, cada trama se encola esperando a que quepa, como en la versión original
+
+#ifdef CAN_FD
+#ifndef TWAI_SUSTITUTO_FD
+#error "El TWAI del ESP32 no admite CAN FD: CAN_FD sólo se puede usar con el sustituto de SocketCAN"
+#endif
+// Longitud máxima de los datos de una trama
+const uint8_t LONGITUD_TRAMA_TRANSPORTE = TWAI_FD_FRAME_MAX_LEN;
+// Conmutación de bitrate (BRS): la fase de datos va al bitrate de datos
+const bool CONMUTACION_BITRATE_FD = true;
+// Bitrate de la fase de datos, en bit/s
+const uint32_t BITRATE_DATOS_FD = 2000000;
+#else
+const uint8_t LONGITUD_TRAMA_TRANSPORTE = TWAI_FRAME_MAX_DLC;
+#endif
+
+// Longitud máxima de una PDU, tamaño del buffer de reensamblado
+const uint16_t LONGITUD_MAXIMA_TRANSPORTE = 4096;
+// Tiempo máximo esperando un control de flujo o la siguiente trama consecutiva (N_Bs y N_Cr)
+const TickType_t ESPERA_MAXIMA_TRANSPORTE = pdMS_TO_TICKS(1000);
+// Número máximo de controles de flujo WAIT seguidos antes de abandonar (N_WFTmax)
+const uint8_t MAX_ESPERAS_TRANSPORTE = 10;
+// Lo que devuelve la dirección del control de flujo para no enviarlo
+const uint32_t SIN_CONTROL_FLUJO_CAN = 0xFFFFFFFF;
+// Alertas del driver que usa el transporte: la de la cola de transmisión vacía y la de transmisión fallida
+const uint32_t ALERTAS_TRANSPORTE_CAN = TWAI_ALERT_TX_IDLE | TWAI_ALERT_TX_FAILED;
+
+// Medidas de una transferencia
+struct MedidaTransferencia
+{
+  uint16_t longitud;                  // Bytes de la PDU
+  uint16_t tramas;                    // Tramas de datos enviadas o recibidas
+  uint16_t tramasControl;             // Controles de flujo intercambiados
+  unsigned long tiempoTransferencia;  // Desde la primera trama hasta la última, en us
+  unsigned long tiempoBus;            // Tiempo mínimo de ocupación del bus de todas las tramas, en us
+  unsigned long tiempoEncolado;       // Encolando las tramas consecutivas enviadas, en us
+  unsigned long tiempoFinTransmision; // Desde que se empieza a encolar la última ráfaga hasta que se ha transmitido, en us
+  uint32_t identificador;             // Identificador de las tramas recibidas
+  uint64_t instanteLlegada;           // Llegada de la última trama recibida, en us (micros64)
+};
+
+// Estadísticas acumuladas desde el último reinicio
+struct EstadisticasTransporteCAN
+{
+  uint32_t transferencias;
+  uint32_t errores; // Transferencias abandonadas (tiempo agotado, secuencia, desbordamiento)
+  uint32_t aplazadas; // Tramas de otros emisores aplazadas hasta terminar la transferencia en curso
+  uint32_t descartadas; // Tramas de otros emisores perdidas porque ya no cabían entre las aplazadas
+  uint32_t tramas;
+  uint32_t tramasControl;
+  uint32_t tramasEncoladas;  // Tramas consecutivas enviadas, de las que se mide el encolado
+  uint32_t colaLlena;        // Tramas que no cabían en la cola de transmisión y han tenido que esperar
+  uint32_t finesTransmision; // Transferencias enviadas de las que se ha esperado el fin de la transmisión
+  uint64_t sumatorioTiempoTransferencia;  // en us
+  uint64_t sumatorioTiempoBus;            // en us
+  uint64_t sumatorioTiempoEncolado;       // en us
+  uint64_t sumatorioTiempoFinTransmision; // en us
+};
+
+// Configura el identificador con el que se transmite, el bitrate del bus para
+// estimar el tiempo en el bus y el control de flujo que se pide al otro lado
+void iniciarTransporteCAN(uint32_t identificador, bool extendido, const twai_timing_config_t &tiempos, uint8_t tamanoBloque, uint8_t separacionMinima);
+// Tramas que ocupa una PDU de la longitud indicada, para dimensionar la cola de transmisión del driver
+uint16_t tramasTransporteCAN(uint16_t longitud);
+// Envía una PDU completa. Devuelve false si la transferencia se ha abandonado
+bool enviarTransporteCAN(const uint8_t *datos, uint16_t longitud);
+// Envía una PDU que cabe en una trama tal cual, sin cabecera de transporte
+bool enviarTramaCAN(const uint8_t *datos, uint8_t longitud);
+// Recibe una PDU de una sola trama sin cabecera de transporte y deja en longitud la longitud de la trama.
+// Devuelve los datos de la trama sin copiarlos, válidos hasta la siguiente lectura
+const uint8_t *recibirTramaCAN(uint8_t *longitud);
+// Recibe una PDU completa y deja su longitud en longitud. Cada trama se copia directamente en su
+// posición de destino, de capacidad bytes, o sin destino en el buffer de reensamblado del transporte.
+// longitudEsperada sólo se usa con TRAMADO_DIRECTO, donde no hay cabeceras que la indiquen.
+// Devuelve dónde está la PDU, o NULL si la transferencia se ha abandonado o no cabe
+const uint8_t *recibirTransporteCAN(uint16_t longitudEsperada, uint16_t *longitud, uint8_t *destino = NULL, uint16_t capacidad = 0);
+// Indica a quién se pasan los mensajes del otro lado que llegan mientras se espera un control
+// de flujo y no lo son (las respuestas del modo caudal). Con NULL se ignoran
+void desviarMensajesTransporteCAN(void (*desvio)(const twai_message_t &mensaje));
+// Indica a quién se pregunta el identificador de los controles de flujo, a partir del de la primera trama
+// recibida; si devuelve SIN_CONTROL_FLUJO_CAN no se envían. Con NULL van con el identificador configurado
+void dirigirControlFlujoTransporteCAN(uint32_t (*identificador)(uint32_t recibido));
+// Espera a que el controlador haya transmitido todas las tramas encoladas y, si la última
+// transferencia ha sido un envío, anota el tiempo desde que se empezó a encolar su última ráfaga.
+// Necesita las ALERTAS_TRANSPORTE_CAN en la configuración del driver, salvo con ENVIO_TRAMA_A_TRAMA
+void esperarFinTransmisionCAN();
+// Medidas de la última transferencia enviada o recibida
+const MedidaTransferencia &obtenerUltimaTransferencia();
+// Bitrate en bit/s de una configuración de tiempos del TWAI
+uint32_t bitrateCAN(const twai_timing_config_t &tiempos);
+// Tiempo mínimo en us que ocupa en el bus un mensaje con el bitrate configurado, sin bits de relleno.
+// En los mensajes FD la fase de datos va al bitrate de datos si hay conmutación
+unsigned long tiempoBusMensajeCAN(const twai_message_t &mensaje);
+// Pone a cero las estadísticas
+void reiniciarEstadisticasTransporteCAN();
+// Devuelve las estadísticas acumuladas
+const EstadisticasTransporteCAN &obtenerEstadisticasTransporteCAN();
+// Retraso de las transferencias de varias tramas correctas sobre su tiempo mínimo en el bus, en us
+const HistogramaLatencia &obtenerRetrasoTransporteCAN();
+// Hueco en el bus entre tramas consecutivas recibidas seguidas, sobre su tiempo mínimo en el bus, en us
+const HistogramaLatencia &obtenerHuecoTramasCAN();
+// Muestra por el puerto serie las tramas, los tiempos medios por transferencia, el encolado, el retraso y el hueco entre tramas
+void mostrarEstadisticasTransporteCAN(const char *nombre);
+
+#endif
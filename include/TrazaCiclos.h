@@ -0,0 +1,140 @@
+#ifndef TRAZA_CICLOS_H
+#define TRAZA_CICLOS_H
+
+/*
+Tiempo de 64 bits y trazas por fases con el contador de ciclos de la CPU.
+
+micros64() es el reloj en us del motor de medida: a diferencia de micros(),
+que es unsigned long, no da la vuelta a los 71 minutos, así que los
+sumatorios de las ejecuciones largas (RSA con NUM_REP alto) no se desbordan.
+
+Si se define TRAZA_CICLOS cada iteración se reparte en fases con sondas
+repartidas por el motor, el transporte y los esquemas. Cada sonda lee el
+contador de ciclos (CCOUNT en el ESP32, clock_gettime en ns en Linux) y suma
+los ciclos desde la sonda anterior del mismo hilo a su fase, así que las fases
+cubren toda la iteración sin solaparse:
+- Carga: rellenar los 8 bytes de datos
+- Clave: preparación de la clave que hace el esquema en cada mensaje (clonar los
+  estados de ipad y opad del HMAC, o cargar la clave sin ellos)
+- Criptografía: resto de proteger()
+- Encolado: cada llamada a twai_transmit, una por trama
+- Control de flujo: espera de los controles de flujo del receptor
+- Fin de TX: hasta que el controlador ha terminado de transmitir la última trama
+- Primera RX: hasta que llega la primera trama de la PDU o de la respuesta
+- Resto de RX: las tramas siguientes y la copia de la PDU reensamblada
+- Verificación: verificar() en el lado derecho
+Una sonda cuesta una lectura del contador y unas pocas sumas, unas decenas de
+ciclos; setup() mide su coste y lo muestra. Sin TRAZA_CICLOS las sondas no
+generan código.
+
+El CCOUNT es de 32 bits y da la vuelta a los 17 s a 240 MHz, más que cualquier
+fase de una iteración. Cada hilo lleva su propio estado, así que las etapas del
+modo canalizado se trazan cada una en su núcleo sin compartir nada.
+*/
+
+#include <Arduino.h>
+#ifdef ESP_PLATFORM
+#include <esp_timer.h>
+#include <hal/cpu_hal.h>
+#else
+#include <time.h>
+#endif
+
+// #define TRAZA_CICLOS // Si está definido, se reparte cada iteración en fases con el contador de ciclos
+
+// Tiempo en us desde el arranque, de 64 bits
+inline uint64_t micros64()
+{
+#ifdef ESP_PLATFORM
+  return esp_timer_get_time();
+#else
+  timespec ahora;
+  clock_gettime(CLOCK_MONOTONIC, &ahora);
+  return (uint64_t)ahora.tv_sec * 1000000 + ahora.tv_nsec / 1000;
+#endif
+}
+
+// Fases en que se reparte una iteración, cada una cerrada por su sonda
+enum FaseTraza : uint8_t
+{
+  FASE_CARGA,
+  FASE_CLAVE,
+  FASE_CRIPTO,
+  FASE_ENCOLADO,
+  FASE_CONTROL_FLUJO,
+  FASE_FIN_TX,
+  FASE_PRIMERA_RX,
+  FASE_RESTO_RX,
+  FASE_VERIFICACION,
+  NUM_FASES_TRAZA
+};
+
+#ifdef TRAZA_CICLOS
+// Hilos que pueden trazar a la vez: loop() y la etapa criptográfica, con margen
+const uint8_t MAX_HILOS_TRAZA = 4;
+
+#ifdef ESP_PLATFORM
+typedef uint32_t CiclosTraza; // CCOUNT
+#else
+typedef uint64_t CiclosTraza; // ns del reloj monótono
+#endif
+
+// Estado de la traza de un hilo
+struct EstadoTraza
+{
+  CiclosTraza ultimaSonda;
+  uint64_t ciclos[NUM_FASES_TRAZA];
+  uint32_t sondas[NUM_FASES_TRAZA];
+};
+
+inline CiclosTraza leerCiclos()
+{
+#ifdef ESP_PLATFORM
+  return cpu_hal_get_cycle_count();
+#else
+  timespec ahora;
+  clock_gettime(CLOCK_MONOTONIC, &ahora);
+  return (uint64_t)ahora.tv_sec * 1000000000 + ahora.tv_nsec;
+#endif
+}
+
+// Reserva el estado del hilo que llama la primera vez que traza
+EstadoTraza *registrarHiloTraza();
+
+inline EstadoTraza &estadoTraza()
+{
+  static thread_local EstadoTraza *estado = registrarHiloTraza();
+  return *estado;
+}
+
+// Comienzo de una iteración: lo anterior no se cuenta en ninguna fase
+inline void empezarTraza()
+{
+  estadoTraza().ultimaSonda = leerCiclos();
+}
+
+// Cierra la fase: le suma los ciclos desde la sonda anterior de este hilo
+inline void sondaTraza(FaseTraza fase)
+{
+  EstadoTraza &estado = estadoTraza();
+  CiclosTraza ahora = leerCiclos();
+  estado.ciclos[fase] += (CiclosTraza)(ahora - estado.ultimaSonda);
+  estado.sondas[fase]++;
+  estado.ultimaSonda = ahora;
+}
+
+// Mide el coste de una sonda y lo muestra
+void calibrarTraza();
+// Pone a cero las fases de todos los hilos
+void reiniciarTraza();
+// Muestra el reparto por fases de los mensajes indicados
+void mostrarTraza(const char *nombre, uint32_t mensajes);
+#else
+inline void empezarTraza() {}
+inline void sondaTraza(FaseTraza fase) {}
+inline void calibrarTraza() {}
+inline void reiniciarTraza() {}
+inline void mostrarTraza(const char *nombre, uint32_t mensajes) {}
+#endif
+
+#endif
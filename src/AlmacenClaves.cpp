@@ -0,0 +1,227 @@
+#include <Arduino.h>
+#include "AlmacenClaves.h"
+#include "GeneradorAleatorio.h"
+#ifdef FIRMA_ED25519
+#include <Ed25519.h>
+#endif
+
+// Tamaño máximo de un bloque RSA (RSA-4096)
+static const uint16_t LONGITUD_MAXIMA_RSA = 512;
+
+// Buffers para la operación de preparación de las constantes de Montgomery
+static uint8_t entradaPreparacion[LONGITUD_MAXIMA_RSA];
+static uint8_t salidaPreparacion[LONGITUD_MAXIMA_RSA];
+
+// Realiza una operación con la clave para que mbedtls calcule y guarde RN/RP/RQ y el primer par de cegado en el contexto
+static bool prepararMontgomery(ClaveRSA &clave)
+{
+  size_t longitud = mbedtls_rsa_get_len(clave.contextoRSA);
+  if (longitud > LONGITUD_MAXIMA_RSA)
+  {
+    return false;
+  }
+  memset(entradaPreparacion, 0, longitud);
+  entradaPreparacion[longitud - 1] = 2; // Cualquier valor menor que N sirve
+  unsigned long tiempoInicial = micros();
+  int resultado;
+  if (clave.privada)
+  {
+    resultado = mbedtls_rsa_private(clave.contextoRSA, generarAleatorio, NULL, entradaPreparacion, salidaPreparacion);
+  }
+  else
+  {
+    resultado = mbedtls_rsa_public(clave.contextoRSA, entradaPreparacion, salidaPreparacion);
+  }
+  clave.tiempoMontgomery = micros() - tiempoInicial;
+  return resultado == 0;
+}
+
+// Comprueba que la clave parseada es RSA y la prepara; si algo falla libera el contexto
+static bool prepararClaveRSA(ClaveRSA &clave)
+{
+  if (mbedtls_pk_get_type(&clave.contextoClave) != MBEDTLS_PK_RSA)
+  {
+    Serial.println("La clave no es RSA");
+    mbedtls_pk_free(&clave.contextoClave);
+    return false;
+  }
+  clave.contextoRSA = mbedtls_pk_rsa(clave.contextoClave);
+  clave.cargada = prepararMontgomery(clave);
+  if (!clave.cargada)
+  {
+    Serial.println("Fallo al preparar las constantes de Montgomery de la clave RSA");
+    mbedtls_pk_free(&clave.contextoClave);
+  }
+  return clave.cargada;
+}
+
+bool cargarClavePrivadaRSA(ClaveRSA &clave, const char *pem)
+{
+  clave.privada = true;
+  clave.cargada = false;
+  mbedtls_pk_init(&clave.contextoClave); // Inicializamos el contexto de la clave
+  unsigned long tiempoInicial = micros();
+  int resultado = mbedtls_pk_parse_key(&clave.contextoClave, (const unsigned char *)pem, strlen(pem) + 1, NULL, 0); // Parsear clave
+  clave.tiempoParseo = micros() - tiempoInicial;
+  if (resultado != 0)
+  {
+    Serial.printf("Fallo al parsear la clave privada RSA: -0x%04X\n", -resultado);
+    mbedtls_pk_free(&clave.contextoClave);
+    return false;
+  }
+  return prepararClaveRSA(clave);
+}
+
+bool cargarClavePublicaRSA(ClaveRSA &clave, const char *pem)
+{
+  clave.privada = false;
+  clave.cargada = false;
+  mbedtls_pk_init(&clave.contextoClave); // Inicializamos el contexto de la clave
+  unsigned long tiempoInicial = micros();
+  int resultado = mbedtls_pk_parse_public_key(&clave.contextoClave, (const unsigned char *)pem, strlen(pem) + 1); // Parsear clave
+  clave.tiempoParseo = micros() - tiempoInicial;
+  if (resultado != 0)
+  {
+    Serial.printf("Fallo al parsear la clave pública RSA: -0x%04X\n", -resultado);
+    mbedtls_pk_free(&clave.contextoClave);
+    return false;
+  }
+  return prepararClaveRSA(clave);
+}
+
+void liberarClaveRSA(ClaveRSA &clave)
+{
+  // mbedtls_pk_free ya libera el contexto RSA que contiene
+  mbedtls_pk_free(&clave.contextoClave);
+  clave.contextoRSA = NULL;
+  clave.cargada = false;
+}
+
+void mostrarCosteClaveRSA(const ClaveRSA &clave, const char *nombre)
+{
+  Serial.printf("Clave %s %s: parseo %lu us, preparación Montgomery %lu us\n",
+                nombre, clave.privada ? "privada" : "pública", clave.tiempoParseo, clave.tiempoMontgomery);
+}
+
+// Multiplica G por un escalar cualquiera para que mbedtls calcule y guarde en el grupo la tabla del generador
+static bool prepararTablaGenerador(ClaveEC &clave)
+{
+  mbedtls_mpi escalar;
+  mbedtls_ecp_point resultado;
+  mbedtls_mpi_init(&escalar);
+  mbedtls_ecp_point_init(&resultado);
+  mbedtls_mpi_lset(&escalar, 2); // Cualquier valor entre 1 y n - 1 sirve
+  unsigned long tiempoInicial = micros();
+  int error = mbedtls_ecp_mul(&clave.contextoEC->grp, &resultado, &escalar, &clave.contextoEC->grp.G, generarAleatorio, NULL);
+  clave.tiempoPrecalculo = micros() - tiempoInicial;
+  mbedtls_ecp_point_free(&resultado);
+  mbedtls_mpi_free(&escalar);
+  return error == 0;
+}
+
+// Comprueba que la clave parseada es de curva elíptica P-256 y la prepara; si algo falla libera el contexto
+static bool prepararClaveEC(ClaveEC &clave)
+{
+  if (mbedtls_pk_get_type(&clave.contextoClave) != MBEDTLS_PK_ECKEY)
+  {
+    Serial.println("La clave no es de curva elíptica");
+    mbedtls_pk_free(&clave.contextoClave);
+    return false;
+  }
+  clave.contextoEC = mbedtls_pk_ec(clave.contextoClave);
+  if (clave.contextoEC->grp.id != MBEDTLS_ECP_DP_SECP256R1)
+  {
+    Serial.println("La clave no es de la curva P-256");
+    mbedtls_pk_free(&clave.contextoClave);
+    return false;
+  }
+  clave.cargada = prepararTablaGenerador(clave);
+  if (!clave.cargada)
+  {
+    Serial.println("Fallo al precalcular la tabla del generador de la clave EC");
+    mbedtls_pk_free(&clave.contextoClave);
+  }
+  return clave.cargada;
+}
+
+bool cargarClavePrivadaEC(ClaveEC &clave, const char *pem)
+{
+  clave.privada = true;
+  clave.cargada = false;
+  mbedtls_pk_init(&clave.contextoClave); // Inicializamos el contexto de la clave
+  unsigned long tiempoInicial = micros();
+  int resultado = mbedtls_pk_parse_key(&clave.contextoClave, (const unsigned char *)pem, strlen(pem) + 1, NULL, 0); // Parsear clave
+  clave.tiempoParseo = micros() - tiempoInicial;
+  if (resultado != 0)
+  {
+    Serial.printf("Fallo al parsear la clave privada EC: -0x%04X\n", -resultado);
+    mbedtls_pk_free(&clave.contextoClave);
+    return false;
+  }
+  return prepararClaveEC(clave);
+}
+
+bool cargarClavePublicaEC(ClaveEC &clave, const char *pem)
+{
+  clave.privada = false;
+  clave.cargada = false;
+  mbedtls_pk_init(&clave.contextoClave); // Inicializamos el contexto de la clave
+  unsigned long tiempoInicial = micros();
+  int resultado = mbedtls_pk_parse_public_key(&clave.contextoClave, (const unsigned char *)pem, strlen(pem) + 1); // Parsear clave
+  clave.tiempoParseo = micros() - tiempoInicial;
+  if (resultado != 0)
+  {
+    Serial.printf("Fallo al parsear la clave pública EC: -0x%04X\n", -resultado);
+    mbedtls_pk_free(&clave.contextoClave);
+    return false;
+  }
+  return prepararClaveEC(clave);
+}
+
+void liberarClaveEC(ClaveEC &clave)
+{
+  // mbedtls_pk_free ya libera el par de claves y la tabla del generador que contiene
+  mbedtls_pk_free(&clave.contextoClave);
+  clave.contextoEC = NULL;
+  clave.cargada = false;
+}
+
+void mostrarCosteClaveEC(const ClaveEC &clave, const char *nombre)
+{
+  Serial.printf("Clave %s %s: parseo %lu us, precálculo del generador %lu us\n",
+                nombre, clave.privada ? "privada" : "pública", clave.tiempoParseo, clave.tiempoPrecalculo);
+}
+
+#ifdef FIRMA_ED25519
+bool cargarClavePrivadaEd25519(ClaveEd25519 &clave, const uint8_t *semilla, const uint8_t *publica)
+{
+  clave.privada = true;
+  memcpy(clave.semilla, semilla, LONGITUD_CLAVE_EC);
+  unsigned long tiempoInicial = micros();
+  Ed25519::derivePublicKey(clave.publica, clave.semilla);
+  clave.tiempoDerivacion = micros() - tiempoInicial;
+  // La firma usa la clave pública, así que tiene que ser la de la semilla
+  clave.cargada = memcmp(clave.publica, publica, LONGITUD_CLAVE_EC) == 0;
+  if (!clave.cargada)
+  {
+    Serial.println("La clave pública Ed25519 no corresponde a la semilla");
+  }
+  return clave.cargada;
+}
+
+bool cargarClavePublicaEd25519(ClaveEd25519 &clave, const uint8_t *publica)
+{
+  clave.privada = false;
+  memset(clave.semilla, 0, LONGITUD_CLAVE_EC);
+  memcpy(clave.publica, publica, LONGITUD_CLAVE_EC);
+  clave.tiempoDerivacion = 0;
+  clave.cargada = true;
+  return true;
+}
+
+void mostrarCosteClaveEd25519(const ClaveEd25519 &clave, const char *nombre)
+{
+  Serial.printf("Clave %s %s: derivación de la clave pública %lu us\n",
+                nombre, clave.privada ? "privada" : "pública", clave.tiempoDerivacion);
+}
+#endif
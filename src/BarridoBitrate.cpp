@@ -0,0 +1,272 @@
+#include "BarridoBitrate.h"
+
+// Tiempos del TWAI de cada bitrate admitido
+struct TiemposBitrate
+{
+  uint32_t bitrate;
+  twai_timing_config_t tiempos;
+};
+
+static const TiemposBitrate TIEMPOS_BITRATE[] = {
+    {125000, TWAI_TIMING_CONFIG_125KBITS()},
+    {250000, TWAI_TIMING_CONFIG_250KBITS()},
+    {500000, TWAI_TIMING_CONFIG_500KBITS()},
+    {800000, TWAI_TIMING_CONFIG_800KBITS()},
+    {1000000, TWAI_TIMING_CONFIG_1MBITS()},
+};
+
+bool tiemposBitrateCAN(uint32_t bitrate, twai_timing_config_t *tiempos)
+{
+  for (const TiemposBitrate &admitido : TIEMPOS_BITRATE)
+  {
+    if (admitido.bitrate == bitrate)
+    {
+      *tiempos = admitido.tiempos;
+      return true;
+    }
+  }
+  return false;
+}
+
+#ifdef BARRIDO_BITRATE
+#include "ReceptorCAN.h"
+#include "TransporteCAN.h"
+#include "MotorBenchmark.h"
+
+#ifdef MODO_MULTINODO
+#error "BARRIDO_BITRATE coordina el cambio entre dos nodos: no se puede combinar con MODO_MULTINODO"
+#endif
+#ifdef MODO_CAUDAL
+#error "BARRIDO_BITRATE toma la latencia de cada iteración, que no existe en MODO_CAUDAL"
+#endif
+
+// Tipos de trama de control, en el primer byte. El segundo lleva el punto del barrido
+const uint8_t CONTROL_CAMBIO_BITRATE = 0xC1; // Izquierdo, con el bitrate actual: pasar al punto
+const uint8_t CONTROL_CAMBIO_ACEPTADO = 0xC2; // Derecho: va a pasar al punto
+const uint8_t CONTROL_SINCRONIZAR = 0xC3;     // Izquierdo, con el bitrate nuevo
+const uint8_t CONTROL_SINCRONIZADO = 0xC4;    // Derecho: preparado para medir con el bitrate nuevo
+
+// Fila de la matriz: un esquema con la media de la iteración y el tiempo en el bus de cada punto, en us
+struct FilaBarridoBitrate
+{
+  const char *esquema;
+  double latencia[PUNTOS_BARRIDO];
+  double tiempoBus[PUNTOS_BARRIDO];
+  bool medido[PUNTOS_BARRIDO];
+};
+
+static twai_general_config_t configuracionGeneral;
+static twai_filter_config_t configuracionFiltro;
+static twai_timing_config_t tiemposActuales;
+static twai_message_t mensajeControl;
+// Punto en uso; PUNTOS_BARRIDO mientras se sigue con el bitrate de setup()
+static uint8_t puntoActual = PUNTOS_BARRIDO;
+static FilaBarridoBitrate filasBarrido[MAX_ESQUEMAS_BARRIDO];
+static uint8_t numeroFilasBarrido = 0;
+static char nombreCSV[48];
+
+void iniciarBarridoBitrate(const twai_general_config_t &general, const twai_filter_config_t &filtro, const twai_timing_config_t &tiempos,
+                           uint32_t identificador, bool extendido)
+{
+  configuracionGeneral = general;
+  configuracionFiltro = filtro;
+  tiemposActuales = tiempos;
+  memset(&mensajeControl, 0, sizeof(mensajeControl));
+  mensajeControl.extd = extendido;
+  mensajeControl.identifier = identificador;
+  mensajeControl.data_length_code = 2;
+  puntoActual = PUNTOS_BARRIDO;
+  numeroFilasBarrido = 0;
+}
+
+static void enviarControl(uint8_t tipo, uint8_t punto)
+{
+  mensajeControl.data[0] = tipo;
+  mensajeControl.data[1] = punto;
+  twai_transmit(&mensajeControl, ESPERA_CONTROL_BARRIDO);
+}
+
+// Espera una trama de control del tipo indicado y deja su punto. Devuelve false si pasa la espera sin ninguna.
+// Cualquier otro mensaje, como una respuesta rezagada, se descarta
+static bool esperarControl(uint8_t tipo, TickType_t espera, uint8_t *punto)
+{
+  const twai_message_t *mensaje;
+  while ((mensaje = leerMensajeCAN(espera)) != NULL)
+  {
+    if (mensaje->data_length_code >= 2 && mensaje->data[0] == tipo)
+    {
+      *punto = mensaje->data[1];
+      return true;
+    }
+  }
+  return false;
+}
+
+// Reinstala el driver con el bitrate del punto, con la tarea receptora fuera de él
+static void reinstalarDriver(uint8_t punto)
+{
+  pausarReceptorCAN();
+  twai_stop();
+  twai_driver_uninstall();
+  tiemposBitrateCAN(BITRATES_BARRIDO[punto], &tiemposActuales);
+  while (twai_driver_install(&configuracionGeneral, &tiemposActuales, &configuracionFiltro) != ESP_OK) // Bucle mientras no esté todo correcto
+  {
+    Serial.println("Fallo al reinstalar el driver del CAN");
+    delay(100);
+  }
+  while (twai_start() != ESP_OK) // Bucle mientras no esté todo correcto
+  {
+    Serial.println("Fallo al reiniciar el driver del CAN");
+    delay(100);
+  }
+  reanudarReceptorCAN();
+  puntoActual = punto;
+  Serial.printf("Bitrate del CAN: %lu bit/s\n", (unsigned long)BITRATES_BARRIDO[punto]);
+}
+
+void proponerBitrateCAN(uint8_t punto)
+{
+  uint8_t aceptado;
+  // Pedimos el cambio con el bitrate actual hasta que el derecho lo acepta
+  do
+  {
+    enviarControl(CONTROL_CAMBIO_BITRATE, punto);
+  } while (!esperarControl(CONTROL_CAMBIO_ACEPTADO, ESPERA_CONTROL_BARRIDO, &aceptado) || aceptado != punto);
+  // El derecho cambia tras 2 esperas sin peticiones; nosotros tras 3 sin aceptaciones, así que cambiamos después
+  while (esperarControl(CONTROL_CAMBIO_ACEPTADO, 3 * ESPERA_CONTROL_BARRIDO, &aceptado))
+  {
+  }
+  if (punto >= PUNTOS_BARRIDO)
+  {
+    return;
+  }
+  reinstalarDriver(punto);
+  // Con el bitrate nuevo repetimos la sincronización hasta que el derecho contesta
+  do
+  {
+    enviarControl(CONTROL_SINCRONIZAR, punto);
+  } while (!esperarControl(CONTROL_SINCRONIZADO, ESPERA_CONTROL_BARRIDO, &aceptado));
+  // Igual que antes, el derecho empieza a esperar la primera PDU antes de que se la enviemos
+  while (esperarControl(CONTROL_SINCRONIZADO, 3 * ESPERA_CONTROL_BARRIDO, &aceptado))
+  {
+  }
+}
+
+uint8_t aceptarBitrateCAN()
+{
+  uint8_t punto;
+  uint8_t repetido;
+  while (!esperarControl(CONTROL_CAMBIO_BITRATE, portMAX_DELAY, &punto))
+  {
+  }
+  enviarControl(CONTROL_CAMBIO_ACEPTADO, punto);
+  // Las peticiones repetidas mientras tanto se vuelven a aceptar
+  while (esperarControl(CONTROL_CAMBIO_BITRATE, 2 * ESPERA_CONTROL_BARRIDO, &repetido))
+  {
+    punto = repetido;
+    enviarControl(CONTROL_CAMBIO_ACEPTADO, punto);
+  }
+  esperarFinTransmisionCAN();
+  if (punto >= PUNTOS_BARRIDO)
+  {
+    return PUNTOS_BARRIDO;
+  }
+  reinstalarDriver(punto);
+  while (!esperarControl(CONTROL_SINCRONIZAR, portMAX_DELAY, &repetido))
+  {
+  }
+  enviarControl(CONTROL_SINCRONIZADO, punto);
+  while (esperarControl(CONTROL_SINCRONIZAR, 2 * ESPERA_CONTROL_BARRIDO, &repetido))
+  {
+    enviarControl(CONTROL_SINCRONIZADO, punto);
+  }
+  return punto;
+}
+
+const twai_timing_config_t &tiemposBarridoBitrate()
+{
+  return tiemposActuales;
+}
+
+const char *nombreBarridoBitrate(const char *esquema)
+{
+  if (puntoActual >= PUNTOS_BARRIDO)
+  {
+    return esquema;
+  }
+  snprintf(nombreCSV, sizeof(nombreCSV), "%s @%lukbit/s", esquema, (unsigned long)(BITRATES_BARRIDO[puntoActual] / 1000));
+  return nombreCSV;
+}
+
+void anotarBarridoBitrate(const char *esquema, double latenciaMedia, double tiempoBus)
+{
+  if (puntoActual >= PUNTOS_BARRIDO)
+  {
+    return;
+  }
+  // Los esquemas se miden en el mismo orden con cada bitrate, pero se buscan por nombre por si acaso
+  FilaBarridoBitrate *fila = NULL;
+  for (uint8_t i = 0; i < numeroFilasBarrido; i++)
+  {
+    if (strcmp(filasBarrido[i].esquema, esquema) == 0)
+    {
+      fila = &filasBarrido[i];
+      break;
+    }
+  }
+  if (fila == NULL)
+  {
+    if (numeroFilasBarrido == MAX_ESQUEMAS_BARRIDO)
+    {
+      return;
+    }
+    fila = &filasBarrido[numeroFilasBarrido++];
+    memset(fila, 0, sizeof(*fila));
+    fila->esquema = esquema;
+  }
+  fila->latencia[puntoActual] = latenciaMedia;
+  fila->tiempoBus[puntoActual] = tiempoBus;
+  fila->medido[puntoActual] = true;
+}
+
+void mostrarBarridoBitrate()
+{
+  Serial.println("Latencia media por mensaje frente a bitrate, en ms (entre paréntesis, % en el bus)");
+  Serial.printf("%-24s", "Esquema");
+  for (uint8_t p = 0; p < PUNTOS_BARRIDO; p++)
+  {
+    Serial.printf(" %10lu kbit/s", (unsigned long)(BITRATES_BARRIDO[p] / 1000));
+  }
+  Serial.println("  Limitado por la CPU");
+  for (uint8_t i = 0; i < numeroFilasBarrido; i++)
+  {
+    const FilaBarridoBitrate &fila = filasBarrido[i];
+    Serial.printf("%-24s", fila.esquema);
+    // Primer bitrate en que el bus es menos de LIMITE_BUS_BARRIDO % de la iteración
+    int8_t limiteCPU = -1;
+    for (uint8_t p = 0; p < PUNTOS_BARRIDO; p++)
+    {
+      if (!fila.medido[p] || fila.latencia[p] <= 0)
+      {
+        Serial.printf(" %17s", "-");
+        continue;
+      }
+      // El tiempo en el bus es un mínimo; sólo lo supera la iteración en vcan, donde no hay bitrate
+      double parteBus = fila.tiempoBus[p] < fila.latencia[p] ? 100.0 * fila.tiempoBus[p] / fila.latencia[p] : 100.0;
+      Serial.printf(" %9.3f (%3.0f %%)", fila.latencia[p] / 1000, parteBus);
+      if (limiteCPU < 0 && parteBus < LIMITE_BUS_BARRIDO)
+      {
+        limiteCPU = p;
+      }
+    }
+    if (limiteCPU < 0)
+    {
+      Serial.println("  no, limitado por el bus");
+    }
+    else
+    {
+      Serial.printf("  desde %lu kbit/s\n", (unsigned long)(BITRATES_BARRIDO[limiteCPU] / 1000));
+    }
+  }
+}
+#endif
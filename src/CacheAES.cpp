@@ -0,0 +1,75 @@
+#include <Arduino.h>
+#include "CacheAES.h"
+
+// Contexto guardado junto con la clave que lo identifica
+struct EntradaCacheAES
+{
+  const uint8_t *clave;          // La clave se identifica por su dirección
+  uint16_t bits;                 // Longitud de la clave en bits
+  int sentido;                   // MBEDTLS_AES_ENCRYPT o MBEDTLS_AES_DECRYPT
+  mbedtls_aes_context contexto;  // Contexto con las claves de ronda ya calculadas
+  unsigned long tiempoExpansion; // Tiempo de inicialización y expansión de clave en us
+};
+
+static EntradaCacheAES entradasCacheAES[MAX_CONTEXTOS_AES];
+static uint8_t numeroEntradasAES = 0;
+
+mbedtls_aes_context *obtenerContextoAES(const uint8_t *clave, uint16_t bits, int sentido)
+{
+  // Buscamos si ya existe el contexto
+  for (uint8_t i = 0; i < numeroEntradasAES; i++)
+  {
+    EntradaCacheAES &entrada = entradasCacheAES[i];
+    if (entrada.clave == clave && entrada.bits == bits && entrada.sentido == sentido)
+    {
+      return &entrada.contexto;
+    }
+  }
+  if (numeroEntradasAES >= MAX_CONTEXTOS_AES)
+  {
+    return NULL;
+  }
+  // No existe, así que expandimos la clave una única vez
+  EntradaCacheAES &entrada = entradasCacheAES[numeroEntradasAES];
+  unsigned long tiempoInicial = micros();
+  mbedtls_aes_init(&entrada.contexto); // Inicializamos el cifrador AES
+  int resultado;
+  if (sentido == MBEDTLS_AES_ENCRYPT)
+  {
+    resultado = mbedtls_aes_setkey_enc(&entrada.contexto, clave, bits);
+  }
+  else
+  {
+    resultado = mbedtls_aes_setkey_dec(&entrada.contexto, clave, bits);
+  }
+  entrada.tiempoExpansion = micros() - tiempoInicial;
+  if (resultado != 0)
+  {
+    mbedtls_aes_free(&entrada.contexto);
+    return NULL;
+  }
+  entrada.clave = clave;
+  entrada.bits = bits;
+  entrada.sentido = sentido;
+  numeroEntradasAES++;
+  return &entrada.contexto;
+}
+
+void mostrarCosteCacheAES()
+{
+  for (uint8_t i = 0; i < numeroEntradasAES; i++)
+  {
+    const EntradaCacheAES &entrada = entradasCacheAES[i];
+    Serial.printf("Contexto AES-%u de %s: expansión de clave %lu us\n", entrada.bits,
+                  entrada.sentido == MBEDTLS_AES_ENCRYPT ? "cifrado" : "descifrado", entrada.tiempoExpansion);
+  }
+}
+
+void vaciarCacheAES()
+{
+  for (uint8_t i = 0; i < numeroEntradasAES; i++)
+  {
+    mbedtls_aes_free(&entradasCacheAES[i].contexto); // Limpiamos el cifrador AES
+  }
+  numeroEntradasAES = 0;
+}
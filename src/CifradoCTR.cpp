@@ -0,0 +1,33 @@
+#include "CifradoCTR.h"
+
+void formarBloqueCTR(uint32_t identificador, uint8_t dominio, uint64_t contador, uint32_t bloque, uint8_t *salida)
+{
+  for (uint8_t i = 0; i < 4; i++)
+  {
+    salida[i] = identificador >> (8 * (3 - i));
+  }
+  for (uint8_t i = 0; i < 8; i++)
+  {
+    salida[4 + i] = contador >> (8 * (7 - i));
+  }
+  salida[12] = dominio;
+  for (uint8_t i = 0; i < 3; i++)
+  {
+    salida[13 + i] = bloque >> (8 * (2 - i));
+  }
+}
+
+void generarFlujoCTR(mbedtls_aes_context *cifrador, uint32_t identificador, uint8_t dominio, uint64_t contador, uint8_t *flujo)
+{
+  uint8_t bloqueContador[LONGITUD_BLOQUE_CTR];
+  formarBloqueCTR(identificador, dominio, contador, 0, bloqueContador);
+  mbedtls_aes_crypt_ecb(cifrador, MBEDTLS_AES_ENCRYPT, bloqueContador, flujo);
+}
+
+void aplicarFlujoCTR(const uint8_t *flujo, const uint8_t *entrada, uint8_t *salida, uint8_t longitud)
+{
+  for (uint8_t i = 0; i < longitud; i++)
+  {
+    salida[i] = entrada[i] ^ flujo[i];
+  }
+}
@@ -0,0 +1,29 @@
+#include "ContadorCopias.h"
+
+#ifdef CONTAR_COPIAS
+#include <atomic>
+
+static std::atomic<uint64_t> bytesCopiados[2];
+
+void contarCopia(SentidoCopia sentido, uint32_t bytes)
+{
+  bytesCopiados[sentido].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void reiniciarCopias()
+{
+  bytesCopiados[COPIA_ENVIO] = 0;
+  bytesCopiados[COPIA_RECEPCION] = 0;
+}
+
+void mostrarCopias(const char *nombre, uint32_t mensajes)
+{
+  if (mensajes == 0)
+  {
+    return;
+  }
+  double envio = (double)bytesCopiados[COPIA_ENVIO].load() / mensajes;
+  double recepcion = (double)bytesCopiados[COPIA_RECEPCION].load() / mensajes;
+  Serial.printf("Copias %s: %.1f bytes copiados por mensaje (%.1f en el envío y %.1f en la recepción)\n", nombre, envio + recepcion, envio, recepcion);
+}
+#endif
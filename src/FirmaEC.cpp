@@ -0,0 +1,129 @@
+#include <Arduino.h>
+#include <mbedtls/ecdsa.h>
+#include <mbedtls/sha256.h>
+#include "FirmaEC.h"
+#include "GeneradorAleatorio.h"
+
+// Longitud máxima de los datos firmados con Schnorr, que van detrás de la coordenada x del compromiso
+static const uint8_t LONGITUD_MAXIMA_DATOS_SCHNORR = 64;
+
+bool firmarECDSA(ClaveEC &clave, const uint8_t *datos, size_t longitud, uint8_t *firma)
+{
+  int ret;
+  uint8_t resumen[LONGITUD_CLAVE_EC];
+  mbedtls_mpi r, s;
+  mbedtls_mpi_init(&r);
+  mbedtls_mpi_init(&s);
+  MBEDTLS_MPI_CHK(mbedtls_sha256_ret(datos, longitud, resumen, 0));
+  MBEDTLS_MPI_CHK(mbedtls_ecdsa_sign(&clave.contextoEC->grp, &r, &s, &clave.contextoEC->d,
+                                     resumen, sizeof(resumen), generarAleatorio, NULL));
+  MBEDTLS_MPI_CHK(mbedtls_mpi_write_binary(&r, firma, LONGITUD_CLAVE_EC));
+  MBEDTLS_MPI_CHK(mbedtls_mpi_write_binary(&s, firma + LONGITUD_CLAVE_EC, LONGITUD_CLAVE_EC));
+cleanup:
+  mbedtls_mpi_free(&r);
+  mbedtls_mpi_free(&s);
+  return ret == 0;
+}
+
+bool verificarECDSA(ClaveEC &clave, const uint8_t *datos, size_t longitud, const uint8_t *firma)
+{
+  int ret;
+  uint8_t resumen[LONGITUD_CLAVE_EC];
+  mbedtls_mpi r, s;
+  mbedtls_mpi_init(&r);
+  mbedtls_mpi_init(&s);
+  MBEDTLS_MPI_CHK(mbedtls_sha256_ret(datos, longitud, resumen, 0));
+  MBEDTLS_MPI_CHK(mbedtls_mpi_read_binary(&r, firma, LONGITUD_CLAVE_EC));
+  MBEDTLS_MPI_CHK(mbedtls_mpi_read_binary(&s, firma + LONGITUD_CLAVE_EC, LONGITUD_CLAVE_EC));
+  // mbedtls_ecdsa_verify ya rechaza r o s fuera de [1, n - 1]
+  MBEDTLS_MPI_CHK(mbedtls_ecdsa_verify(&clave.contextoEC->grp, resumen, sizeof(resumen),
+                                       &clave.contextoEC->Q, &r, &s));
+cleanup:
+  mbedtls_mpi_free(&r);
+  mbedtls_mpi_free(&s);
+  return ret == 0;
+}
+
+// resumen = SHA-256(x(W) || datos)
+static int resumirCompromiso(const mbedtls_ecp_point &compromiso, const uint8_t *datos, size_t longitud, uint8_t *resumen)
+{
+  uint8_t entrada[LONGITUD_CLAVE_EC + LONGITUD_MAXIMA_DATOS_SCHNORR];
+  if (longitud > LONGITUD_MAXIMA_DATOS_SCHNORR)
+  {
+    return MBEDTLS_ERR_MPI_BAD_INPUT_DATA;
+  }
+  int ret = mbedtls_mpi_write_binary(&compromiso.X, entrada, LONGITUD_CLAVE_EC);
+  if (ret != 0)
+  {
+    return ret;
+  }
+  memcpy(entrada + LONGITUD_CLAVE_EC, datos, longitud);
+  return mbedtls_sha256_ret(entrada, LONGITUD_CLAVE_EC + longitud, resumen, 0);
+}
+
+bool firmarSchnorr(ClaveEC &clave, const uint8_t *datos, size_t longitud, uint8_t *firma)
+{
+  int ret;
+  mbedtls_ecp_group &grupo = clave.contextoEC->grp;
+  mbedtls_mpi k, r, s;
+  mbedtls_ecp_point compromiso;
+  mbedtls_mpi_init(&k);
+  mbedtls_mpi_init(&r);
+  mbedtls_mpi_init(&s);
+  mbedtls_ecp_point_init(&compromiso);
+  do
+  {
+    // W = k·G con k aleatorio en [1, n - 1]
+    MBEDTLS_MPI_CHK(mbedtls_ecp_gen_privkey(&grupo, &k, generarAleatorio, NULL));
+    MBEDTLS_MPI_CHK(mbedtls_ecp_mul(&grupo, &compromiso, &k, &grupo.G, generarAleatorio, NULL));
+    // r = SHA-256(x(W) || datos), que va tal cual en la firma
+    MBEDTLS_MPI_CHK(resumirCompromiso(compromiso, datos, longitud, firma));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_read_binary(&r, firma, LONGITUD_CLAVE_EC));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&r, &r, &grupo.N));
+    // s = k + r·d mod n
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&s, &r, &clave.contextoEC->d));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_add_mpi(&s, &s, &k));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&s, &s, &grupo.N));
+  } while (mbedtls_mpi_cmp_int(&r, 0) == 0 || mbedtls_mpi_cmp_int(&s, 0) == 0); // Casi imposible, pero no valen
+  MBEDTLS_MPI_CHK(mbedtls_mpi_write_binary(&s, firma + LONGITUD_CLAVE_EC, LONGITUD_CLAVE_EC));
+cleanup:
+  mbedtls_ecp_point_free(&compromiso);
+  mbedtls_mpi_free(&k);
+  mbedtls_mpi_free(&r);
+  mbedtls_mpi_free(&s);
+  return ret == 0;
+}
+
+bool verificarSchnorr(ClaveEC &clave, const uint8_t *datos, size_t longitud, const uint8_t *firma)
+{
+  int ret;
+  bool valida = false;
+  uint8_t resumen[LONGITUD_CLAVE_EC];
+  mbedtls_ecp_group &grupo = clave.contextoEC->grp;
+  mbedtls_mpi r, s;
+  mbedtls_ecp_point compromiso;
+  mbedtls_mpi_init(&r);
+  mbedtls_mpi_init(&s);
+  mbedtls_ecp_point_init(&compromiso);
+  MBEDTLS_MPI_CHK(mbedtls_mpi_read_binary(&r, firma, LONGITUD_CLAVE_EC));
+  MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&r, &r, &grupo.N));
+  MBEDTLS_MPI_CHK(mbedtls_mpi_read_binary(&s, firma + LONGITUD_CLAVE_EC, LONGITUD_CLAVE_EC));
+  if (mbedtls_mpi_cmp_int(&r, 0) == 0 || mbedtls_mpi_cmp_int(&s, 0) == 0 || mbedtls_mpi_cmp_mpi(&s, &grupo.N) >= 0)
+  {
+    goto cleanup;
+  }
+  // W = s·G + (n - r)·Q = s·G - r·Q
+  MBEDTLS_MPI_CHK(mbedtls_mpi_sub_mpi(&r, &grupo.N, &r));
+  MBEDTLS_MPI_CHK(mbedtls_ecp_muladd(&grupo, &compromiso, &s, &grupo.G, &r, &clave.contextoEC->Q));
+  if (mbedtls_ecp_is_zero(&compromiso))
+  {
+    goto cleanup;
+  }
+  MBEDTLS_MPI_CHK(resumirCompromiso(compromiso, datos, longitud, resumen));
+  valida = memcmp(resumen, firma, LONGITUD_CLAVE_EC) == 0;
+cleanup:
+  mbedtls_ecp_point_free(&compromiso);
+  mbedtls_mpi_free(&r);
+  mbedtls_mpi_free(&s);
+  return valida;
+}
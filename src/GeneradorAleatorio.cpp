@@ -0,0 +1,35 @@
+#include <Arduino.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/ctr_drbg.h>
+#include "GeneradorAleatorio.h"
+
+static mbedtls_entropy_context entropia;
+static mbedtls_ctr_drbg_context generador;
+static bool generadorSembrado = false;
+
+bool iniciarGeneradorAleatorio()
+{
+  if (generadorSembrado)
+  {
+    return true;
+  }
+  mbedtls_entropy_init(&entropia);
+  mbedtls_ctr_drbg_init(&generador);
+  const char *personalizacion = "latenciaCAN";
+  int resultado = mbedtls_ctr_drbg_seed(&generador, mbedtls_entropy_func, &entropia,
+                                        (const unsigned char *)personalizacion, strlen(personalizacion));
+  if (resultado != 0)
+  {
+    Serial.printf("Fallo en DRBG seed: -0x%04X\n", -resultado);
+    mbedtls_ctr_drbg_free(&generador);
+    mbedtls_entropy_free(&entropia);
+    return false;
+  }
+  generadorSembrado = true;
+  return true;
+}
+
+int generarAleatorio(void *contexto, unsigned char *salida, size_t longitud)
+{
+  return mbedtls_ctr_drbg_random(&generador, salida, longitud);
+}
@@ -0,0 +1,125 @@
+#include "GeneradorTrafico.h"
+#include "TransporteCAN.h"
+#include "TrazaCiclos.h"
+
+// Estado de cada flujo
+struct EstadoFlujoTrafico
+{
+  FlujoTrafico flujo;
+  twai_message_t mensaje;
+  uint64_t siguiente; // Instante previsto de la siguiente ráfaga, en us
+  uint32_t enviadas;  // Desde el último informe
+  uint32_t descartadas;
+  uint32_t tiempoBusTrama; // en us
+};
+
+static EstadoFlujoTrafico flujosTrafico[MAX_FLUJOS_TRAFICO];
+static uint8_t numeroFlujosTrafico = 0;
+
+bool iniciarGeneradorTrafico(const FlujoTrafico *flujos, uint8_t numeroFlujos, bool extendido, const twai_timing_config_t &tiempos)
+{
+  if (numeroFlujos > MAX_FLUJOS_TRAFICO)
+  {
+    return false;
+  }
+  // El transporte sabe el tiempo de cada trama en el bus; no transmite nada
+  iniciarTransporteCAN(0, extendido, tiempos, 0, 0);
+  numeroFlujosTrafico = numeroFlujos;
+  double cargaTotal = 0;
+  uint64_t ahora = micros64();
+  for (uint8_t i = 0; i < numeroFlujos; i++)
+  {
+    EstadoFlujoTrafico &estado = flujosTrafico[i];
+    memset(&estado, 0, sizeof(estado));
+    estado.flujo = flujos[i];
+    if (estado.flujo.periodo == 0 || estado.flujo.rafaga == 0 || estado.flujo.longitud > TWAI_FRAME_MAX_DLC)
+    {
+      return false;
+    }
+    estado.mensaje.extd = extendido;
+    estado.mensaje.identifier = estado.flujo.identificador;
+    estado.mensaje.data_length_code = estado.flujo.longitud;
+    estado.siguiente = ahora;
+    estado.tiempoBusTrama = tiempoBusMensajeCAN(estado.mensaje);
+    double carga = 100.0 * estado.flujo.rafaga * estado.tiempoBusTrama / estado.flujo.periodo;
+    cargaTotal += carga;
+    Serial.printf("Flujo 0x%03lX: %u tramas de %u bytes cada %lu us, %.1f tramas/s, carga ofrecida %.1f %%\n",
+                  (unsigned long)estado.flujo.identificador, (unsigned)estado.flujo.rafaga, (unsigned)estado.flujo.longitud,
+                  (unsigned long)estado.flujo.periodo, 1000000.0 * estado.flujo.rafaga / estado.flujo.periodo, carga);
+  }
+  Serial.printf("Carga ofrecida total: %.1f %% del bus a %lu bit/s\n", cargaTotal, (unsigned long)bitrateCAN(tiempos));
+  return true;
+}
+
+// Envía una ráfaga del flujo. Cada trama lleva en los datos un contador para distinguirlas en una captura
+static void enviarRafaga(EstadoFlujoTrafico &estado)
+{
+  for (uint8_t i = 0; i < estado.flujo.rafaga; i++)
+  {
+    uint32_t numero = estado.enviadas + estado.descartadas;
+    for (uint8_t j = 0; j < estado.flujo.longitud; j++)
+    {
+      estado.mensaje.data[j] = j < 4 ? numero >> (8 * j) : 0;
+    }
+    if (twai_transmit(&estado.mensaje, ESPERA_TX_TRAFICO) == ESP_OK)
+    {
+      estado.enviadas++;
+    }
+    else
+    {
+      estado.descartadas++;
+    }
+  }
+}
+
+void generarTrafico()
+{
+  uint64_t inicio = micros64();
+  uint64_t fin = inicio + PERIODO_INFORME_TRAFICO;
+  while (numeroFlujosTrafico > 0)
+  {
+    // El flujo con la siguiente ráfaga más próxima
+    EstadoFlujoTrafico *proximo = &flujosTrafico[0];
+    for (uint8_t i = 1; i < numeroFlujosTrafico; i++)
+    {
+      if (flujosTrafico[i].siguiente < proximo->siguiente)
+      {
+        proximo = &flujosTrafico[i];
+      }
+    }
+    if (proximo->siguiente >= fin)
+    {
+      break;
+    }
+    // Esperamos cediendo la CPU mientras queda tiempo y activamente al final
+    uint64_t ahora = micros64();
+    while (ahora < proximo->siguiente)
+    {
+      if (proximo->siguiente - ahora > ESPERA_ACTIVA_TRAFICO)
+      {
+        delay(1);
+      }
+      ahora = micros64();
+    }
+    enviarRafaga(*proximo);
+    proximo->siguiente += proximo->flujo.periodo;
+  }
+  while (micros64() < fin)
+  {
+    delay(1);
+  }
+
+  // Informe del periodo
+  double segundos = (micros64() - inicio) / 1000000.0;
+  double tiempoBus = 0;
+  for (uint8_t i = 0; i < numeroFlujosTrafico; i++)
+  {
+    EstadoFlujoTrafico &estado = flujosTrafico[i];
+    Serial.printf("Flujo 0x%03lX: %lu tramas enviadas, %lu descartadas, %.1f tramas/s\n", (unsigned long)estado.flujo.identificador,
+                  (unsigned long)estado.enviadas, (unsigned long)estado.descartadas, estado.enviadas / segundos);
+    tiempoBus += (double)estado.enviadas * estado.tiempoBusTrama;
+    estado.enviadas = 0;
+    estado.descartadas = 0;
+  }
+  Serial.printf("Carga conseguida: %.1f %% del bus\n", 100.0 * tiempoBus / 1000000 / segundos);
+}
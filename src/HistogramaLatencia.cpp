@@ -0,0 +1,144 @@
+#include <Arduino.h>
+#include <math.h>
+#include "HistogramaLatencia.h"
+
+// Cubeta de un valor: las primeras son exactas y después 32 por potencia de dos
+static uint32_t indiceCubeta(uint64_t valor)
+{
+  if (valor >= (1ULL << 32))
+  {
+    return CUBETAS_LATENCIA - 1;
+  }
+  uint32_t v = (uint32_t)valor;
+  if (v < SUBCUBETAS_LATENCIA)
+  {
+    return v;
+  }
+  uint8_t exponente = 31 - __builtin_clz(v);
+  uint8_t desplazamiento = exponente - BITS_SUBCUBETAS_LATENCIA;
+  return (desplazamiento + 1) * SUBCUBETAS_LATENCIA + ((v >> desplazamiento) - SUBCUBETAS_LATENCIA);
+}
+
+// Menor valor de una cubeta
+static uint64_t inicioCubeta(uint32_t indice)
+{
+  uint32_t grupo = indice >> BITS_SUBCUBETAS_LATENCIA;
+  if (grupo == 0)
+  {
+    return indice;
+  }
+  uint32_t desplazamiento = grupo - 1;
+  return (uint64_t)(SUBCUBETAS_LATENCIA + (indice & (SUBCUBETAS_LATENCIA - 1))) << desplazamiento;
+}
+
+// Número de valores distintos de una cubeta
+static uint64_t anchoCubeta(uint32_t indice)
+{
+  uint32_t grupo = indice >> BITS_SUBCUBETAS_LATENCIA;
+  return grupo == 0 ? 1 : 1ULL << (grupo - 1);
+}
+
+void HistogramaLatencia::reiniciar()
+{
+  memset(cubetas, 0, sizeof(cubetas));
+  muestras = 0;
+  minimo = UINT64_MAX;
+  maximo = 0;
+  media = 0;
+  sumaM2 = 0;
+}
+
+void HistogramaLatencia::anotar(uint64_t valor)
+{
+  cubetas[indiceCubeta(valor)]++;
+  muestras++;
+  if (valor < minimo)
+  {
+    minimo = valor;
+  }
+  if (valor > maximo)
+  {
+    maximo = valor;
+  }
+  double diferencia = valor - media;
+  media += diferencia / muestras;
+  sumaM2 += diferencia * (valor - media);
+}
+
+double HistogramaLatencia::desviacion() const
+{
+  return muestras > 1 ? sqrt(sumaM2 / (muestras - 1)) : 0.0;
+}
+
+uint64_t HistogramaLatencia::percentil(double porcentaje) const
+{
+  if (muestras == 0)
+  {
+    return 0;
+  }
+  // Posición de la muestra buscada en el orden de menor a mayor, empezando en 1
+  uint32_t posicion = (uint32_t)ceil(porcentaje / 100.0 * muestras);
+  if (posicion == 0)
+  {
+    posicion = 1;
+  }
+  uint32_t acumuladas = 0;
+  for (uint32_t i = 0; i < CUBETAS_LATENCIA; i++)
+  {
+    acumuladas += cubetas[i];
+    if (acumuladas >= posicion)
+    {
+      // El centro de la cubeta, sin salirse de los valores que se han visto
+      uint64_t valor = inicioCubeta(i) + anchoCubeta(i) / 2;
+      return valor < minimo ? minimo : (valor > maximo ? maximo : valor);
+    }
+  }
+  return maximo;
+}
+
+void HistogramaLatencia::mostrar(const char *nombre, const char *magnitud) const
+{
+  if (muestras == 0)
+  {
+    return;
+  }
+  Serial.printf("%s %s (us): muestras %lu, mín %llu, media %.1f, desv %.1f, p50 %llu, p90 %llu, p99 %llu, p99.9 %llu, máx %llu\n",
+                magnitud, nombre, (unsigned long)muestras, (unsigned long long)minimo, media, desviacion(),
+                (unsigned long long)percentil(50), (unsigned long long)percentil(90), (unsigned long long)percentil(99),
+                (unsigned long long)percentil(99.9), (unsigned long long)maximo);
+  // Histograma compacto: una entrada por potencia de dos con muestras
+  Serial.printf("Histograma %s %s (us):", magnitud, nombre);
+  uint32_t enOctava = 0;
+  uint8_t octava = 0;
+  for (uint32_t i = 0; i <= CUBETAS_LATENCIA; i++)
+  {
+    uint64_t inicio = i < CUBETAS_LATENCIA ? inicioCubeta(i) : UINT64_MAX;
+    uint8_t octavaCubeta = inicio == 0 ? 0 : 64 - __builtin_clzll(inicio);
+    if (i == CUBETAS_LATENCIA || octavaCubeta != octava)
+    {
+      if (enOctava > 0)
+      {
+        Serial.printf(" [%llu, %llu) %lu", octava == 0 ? 0ULL : 1ULL << (octava - 1), 1ULL << octava, (unsigned long)enOctava);
+      }
+      octava = octavaCubeta;
+      enOctava = 0;
+    }
+    if (i < CUBETAS_LATENCIA)
+    {
+      enOctava += cubetas[i];
+    }
+  }
+  Serial.println();
+}
+
+void HistogramaLatencia::exportarCSV(const char *rol, const char *nombre, const char *magnitud) const
+{
+  if (muestras == 0)
+  {
+    return;
+  }
+  Serial.printf("CSV,latencia,%s,%s,%s,%lu,%llu,%.3f,%.3f,%llu,%llu,%llu,%llu,%llu\n",
+                rol, nombre, magnitud, (unsigned long)muestras, (unsigned long long)minimo, media, desviacion(),
+                (unsigned long long)percentil(50), (unsigned long long)percentil(90), (unsigned long long)percentil(99),
+                (unsigned long long)percentil(99.9), (unsigned long long)maximo);
+}
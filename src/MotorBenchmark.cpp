@@ -0,0 +1,638 @@
+#include "MotorBenchmark.h"
+#include "ReceptorCAN.h"
+#include "TransporteCAN.h"
+#include "ReservaFlujoCTR.h"
+#include "HistogramaLatencia.h"
+#include "TopologiaCAN.h"
+#include "BarridoBitrate.h"
+#include "ContadorCopias.h"
+#ifdef MODO_CANALIZADO
+#include "AnilloSPSC.h"
+#include <atomic>
+#include <freertos/queue.h>
+#endif
+
+// Mensaje que se reutiliza para las respuestas de este lado
+static twai_message_t mensajeCANTransmitido;
+// Última respuesta leída, en el hueco de la recepción: válida hasta la siguiente lectura
+static const twai_message_t *mensajeCANLeido = NULL;
+// Distribución del tiempo de cada iteración y de la operación del esquema en curso
+static HistogramaLatencia latenciaEnvio;
+static HistogramaLatencia latenciaOperacion;
+// Lado izquierdo: latencia de ida de la PDU y verificación en el lado derecho, a partir de las respuestas
+static HistogramaLatencia latenciaIda;
+static HistogramaLatencia latenciaVerificacionRemota;
+static uint64_t sumatorioProcesoRemoto = 0;
+static uint32_t respuestasFallidas = 0;
+// Estado de la respuesta y longitud de sus campos de tiempo
+const uint8_t RESPUESTA_VERIFICADA = 0x00;
+const uint8_t RESPUESTA_FALLIDA = 0xFF;
+const uint32_t TIEMPO_MAXIMO_RESPUESTA = 0xFFFFFF; // 24 bits, unos 16 s
+
+#ifdef MODO_MULTINODO
+#ifdef TRAMADO_DIRECTO
+#error "MODO_MULTINODO necesita las cabeceras del transporte para separar las PDUs de cada emisor"
+#endif
+// Emisor: latencia hasta la primera de las respuestas de cada mensaje
+static HistogramaLatencia latenciaPrimeraRespuesta;
+static bool esperandoPrimeraRespuesta = true;
+// Receptor: primera y última verificación anotadas, para la carga de verificación
+static uint64_t instantePrimeraVerificacion = 0;
+static uint64_t instanteUltimaVerificacion = 0;
+#endif
+
+// Pone a cero las estadísticas de las respuestas del lado izquierdo
+static void reiniciarRespuestas()
+{
+  latenciaIda.reiniciar();
+  latenciaVerificacionRemota.reiniciar();
+  sumatorioProcesoRemoto = 0;
+  respuestasFallidas = 0;
+#ifdef MODO_MULTINODO
+  latenciaPrimeraRespuesta.reiniciar();
+  esperandoPrimeraRespuesta = true;
+#endif
+}
+
+// Escribe un tiempo en 24 bits big endian, saturado
+static void escribirTiempoRespuesta(uint8_t *destino, uint64_t tiempo)
+{
+  uint32_t saturado = tiempo < TIEMPO_MAXIMO_RESPUESTA ? (uint32_t)tiempo : TIEMPO_MAXIMO_RESPUESTA;
+  destino[0] = saturado >> 16;
+  destino[1] = saturado >> 8;
+  destino[2] = saturado;
+}
+
+static uint32_t leerTiempoRespuesta(const uint8_t *origen)
+{
+  return ((uint32_t)origen[0] << 16) | ((uint32_t)origen[1] << 8) | origen[2];
+}
+
+void iniciarMotorBenchmark(uint32_t identificador, bool extendido, const twai_timing_config_t &tiempos, uint8_t tamanoBloque, uint8_t separacionMinima)
+{
+  iniciarTransporteCAN(identificador, extendido, tiempos, tamanoBloque, separacionMinima);
+  memset(&mensajeCANTransmitido, 0, sizeof(mensajeCANTransmitido));
+  mensajeCANTransmitido.extd = extendido;
+  mensajeCANTransmitido.identifier = identificador;
+  mensajeCANTransmitido.data_length_code = LONGITUD_MENSAJE_CAN;
+  latenciaEnvio.reiniciar();
+  latenciaOperacion.reiniciar();
+  reiniciarRespuestas();
+#ifdef SALIDA_CSV
+  Serial.println(CABECERA_CSV_LATENCIA);
+#endif
+  calibrarTraza();
+}
+
+void enviarPDU(const uint8_t *pdu, uint16_t longitud)
+{
+  // Las PDUs que caben en una trama van sin cabecera de transporte, como las PDUs de señales de un bus real
+  if (longitud <= LONGITUD_TRAMA_TRANSPORTE)
+  {
+    enviarTramaCAN(pdu, longitud);
+  }
+  else
+  {
+    enviarTransporteCAN(pdu, longitud);
+  }
+#if !defined(ENVIO_TRAMA_A_TRAMA) || defined(TRAZA_CICLOS)
+  // En ráfaga las tramas siguen en la cola del driver al volver: se espera a la alerta de cola vacía
+  esperarFinTransmisionCAN();
+  sondaTraza(FASE_FIN_TX);
+#endif
+}
+
+bool recibirPDU(uint8_t *pdu, uint16_t longitud, uint64_t *instanteLlegada)
+{
+  if (longitud <= LONGITUD_TRAMA_TRANSPORTE)
+  {
+    uint8_t longitudTrama;
+    const uint8_t *trama = recibirTramaCAN(&longitudTrama);
+    *instanteLlegada = trama != NULL ? obtenerUltimaTransferencia().instanteLlegada : micros64();
+    // En FD la trama puede venir rellenada hasta una longitud válida
+    if (trama == NULL || longitudTrama < longitud)
+    {
+      return false;
+    }
+    memcpy(pdu, trama, longitud);
+    contarCopia(COPIA_RECEPCION, longitud);
+    sondaTraza(FASE_RESTO_RX);
+    return true;
+  }
+  // Las tramas se copian directamente en la PDU, sin pasar por el buffer del transporte
+  uint16_t recibidos;
+  const uint8_t *reensamblada = recibirTransporteCAN(longitud, &recibidos, pdu, longitud);
+  *instanteLlegada = reensamblada != NULL ? obtenerUltimaTransferencia().instanteLlegada : micros64();
+  if (reensamblada == NULL || recibidos != longitud)
+  {
+    return false;
+  }
+  sondaTraza(FASE_RESTO_RX);
+  return true;
+}
+
+uint8_t nodoOrigenPDU()
+{
+  return nodoOrigenTopologiaCAN(obtenerUltimaTransferencia().identificador);
+}
+
+void enviarRespuesta(bool valido, uint64_t instanteLlegada, uint64_t tiempoVerificacion, uint8_t secuencia)
+{
+  mensajeCANTransmitido.data[0] = valido ? RESPUESTA_VERIFICADA : RESPUESTA_FALLIDA;
+  escribirTiempoRespuesta(mensajeCANTransmitido.data + 4, tiempoVerificacion);
+  mensajeCANTransmitido.data[7] = secuencia;
+  mensajeCANTransmitido.data_length_code = LONGITUD_MENSAJE_CAN;
+#ifdef MODO_MULTINODO
+  // La respuesta va al emisor de la última PDU recibida
+  mensajeCANTransmitido.identifier = identificadorRespuestaCAN(obtenerUltimaTransferencia().identificador);
+#endif
+  // El tiempo de proceso se toma lo más tarde posible, justo antes de encolar la respuesta
+  escribirTiempoRespuesta(mensajeCANTransmitido.data + 1, micros64() - instanteLlegada);
+  // Enviar el mensaje CAN
+  twai_transmit(&mensajeCANTransmitido, pdMS_TO_TICKS(1000));
+  sondaTraza(FASE_ENCOLADO);
+#ifdef TRAZA_CICLOS
+  esperarFinTransmisionCAN();
+  sondaTraza(FASE_FIN_TX);
+#endif
+}
+
+void recibirRespuesta(RespuestaBenchmark *respuesta)
+{
+  // Esperamos a que nos llegue el mensaje de vuelta
+  mensajeCANLeido = leerMensajeCAN();
+  sondaTraza(FASE_PRIMERA_RX);
+  respuesta->instanteLlegada = instanteLlegadaCAN();
+  respuesta->valida = mensajeCANLeido->data_length_code == LONGITUD_MENSAJE_CAN && mensajeCANLeido->data[0] == RESPUESTA_VERIFICADA;
+  respuesta->tiempoProceso = leerTiempoRespuesta(mensajeCANLeido->data + 1);
+  respuesta->tiempoVerificacion = leerTiempoRespuesta(mensajeCANLeido->data + 4);
+  respuesta->secuencia = mensajeCANLeido->data[7];
+}
+
+void anotarMedida(uint64_t tiempoTranscurrido, uint64_t tiempoOperacion)
+{
+  latenciaEnvio.anotar(tiempoTranscurrido);
+  latenciaOperacion.anotar(tiempoOperacion);
+#ifdef MODO_MULTINODO
+  esperandoPrimeraRespuesta = true;
+#endif
+}
+
+void anotarRespuesta(uint64_t instanteEnvio, const RespuestaBenchmark &respuesta)
+{
+#ifdef MODO_MULTINODO
+  if (esperandoPrimeraRespuesta)
+  {
+    latenciaPrimeraRespuesta.anotar(respuesta.instanteLlegada - instanteEnvio);
+    esperandoPrimeraRespuesta = false;
+  }
+#endif
+  if (!respuesta.valida)
+  {
+    respuestasFallidas++;
+  }
+  // Ida y vuelta sin el proceso del lado derecho ni el tiempo en el bus de la respuesta: queda
+  // la ida de la PDU desde que se empieza a encolar hasta que el receptor tiene la última trama
+  uint64_t idaYVuelta = respuesta.instanteLlegada - instanteEnvio;
+  uint64_t vuelta = respuesta.tiempoProceso + tiempoBusMensajeCAN(*mensajeCANLeido);
+  latenciaIda.anotar(idaYVuelta > vuelta ? idaYVuelta - vuelta : 0);
+  latenciaVerificacionRemota.anotar(respuesta.tiempoVerificacion);
+  sumatorioProcesoRemoto += respuesta.tiempoProceso;
+}
+
+void anotarMedidaRespuesta(uint64_t tiempoOperacion)
+{
+  latenciaOperacion.anotar(tiempoOperacion);
+#ifdef MODO_MULTINODO
+  instanteUltimaVerificacion = micros64();
+  if (latenciaOperacion.muestras == 1)
+  {
+    instantePrimeraVerificacion = instanteUltimaVerificacion;
+  }
+#endif
+}
+
+void mostrarMedidas(const DescriptorEsquema &esquema)
+{
+  // Mostramos la media y la distribución de cada iteración y de la operación
+  Serial.printf("La media del envío de datos %s ha sido: %f ms\n", esquema.descripcion, latenciaEnvio.media / 1000);
+  Serial.printf("De ellos, la media de la operación %s ha sido: %f ms\n", esquema.nombre, latenciaOperacion.media / 1000);
+  if (latenciaIda.muestras > 0)
+  {
+    Serial.printf("De ellos, la media de la ida de la PDU %s ha sido: %f ms y la del proceso en el receptor: %f ms (verificación %f ms)\n",
+                  esquema.nombre, latenciaIda.media / 1000, (double)sumatorioProcesoRemoto / latenciaIda.muestras / 1000,
+                  latenciaVerificacionRemota.media / 1000);
+  }
+  if (respuestasFallidas > 0)
+  {
+    Serial.printf("El receptor no ha verificado %lu PDUs %s\n", (unsigned long)respuestasFallidas, esquema.nombre);
+  }
+  latenciaEnvio.mostrar(esquema.nombre, "Envío");
+  latenciaOperacion.mostrar(esquema.nombre, "Operación");
+  latenciaIda.mostrar(esquema.nombre, "Ida");
+  latenciaVerificacionRemota.mostrar(esquema.nombre, "Verificación remota");
+#ifdef MODO_MULTINODO
+  // Con varios receptores el envío acaba con la última respuesta; la diferencia con la primera es la cola de respuestas en el bus
+  Serial.printf("Respuestas %s: %u por mensaje\n", esquema.nombre, (unsigned)receptoresTopologiaCAN());
+  latenciaPrimeraRespuesta.mostrar(esquema.nombre, "Primera respuesta");
+#endif
+#ifdef BARRIDO_BITRATE
+  // Tiempo mínimo en el bus de cada iteración: la PDU y la respuesta
+  const EstadisticasTransporteCAN &transporte = obtenerEstadisticasTransporteCAN();
+  double tiempoBus = transporte.transferencias > 0 ? (double)transporte.sumatorioTiempoBus / transporte.transferencias : 0;
+  // La respuesta tiene la misma forma que los mensajes de este lado
+  anotarBarridoBitrate(esquema.nombre, latenciaEnvio.media, tiempoBus + tiempoBusMensajeCAN(mensajeCANTransmitido));
+#endif
+#ifdef SALIDA_CSV
+  const char *nombreCSV = nombreBarridoBitrate(esquema.nombre);
+  latenciaEnvio.exportarCSV("IZQ", nombreCSV, "envio");
+  latenciaOperacion.exportarCSV("IZQ", nombreCSV, "operacion");
+  latenciaIda.exportarCSV("IZQ", nombreCSV, "ida");
+  latenciaVerificacionRemota.exportarCSV("IZQ", nombreCSV, "verificacion_remota");
+  obtenerRetrasoTransporteCAN().exportarCSV("IZQ", nombreCSV, "retraso_transporte");
+#ifdef MODO_MULTINODO
+  latenciaPrimeraRespuesta.exportarCSV("IZQ", nombreCSV, "primera_respuesta");
+#endif
+#endif
+  latenciaEnvio.reiniciar();
+  latenciaOperacion.reiniciar();
+  reiniciarRespuestas();
+  mostrarTraza(esquema.nombre, NUM_REP + 1);
+  reiniciarTraza();
+  mostrarCopias(esquema.nombre, NUM_REP + 1);
+  reiniciarCopias();
+  mostrarEstadisticasReceptorCAN(esquema.nombre);
+  reiniciarEstadisticasReceptorCAN();
+  mostrarEstadisticasTransporteCAN(esquema.nombre);
+  reiniciarEstadisticasTransporteCAN();
+  mostrarEstadisticasReservaCTR(esquema.nombre);
+  reiniciarEstadisticasReservaCTR();
+}
+
+void mostrarMedidasRespuesta(const DescriptorEsquema &esquema)
+{
+  Serial.printf("Recibidos todos los mensajes %s\n", esquema.descripcion);
+  Serial.printf("La media de la operación %s ha sido: %f ms\n", esquema.nombre, latenciaOperacion.media / 1000);
+  latenciaOperacion.mostrar(esquema.nombre, "Operación");
+#ifdef MODO_MULTINODO
+  // Carga de verificación de este receptor: PDUs por segundo y parte del tiempo verificando
+  if (latenciaOperacion.muestras > 1 && instanteUltimaVerificacion > instantePrimeraVerificacion)
+  {
+    double segundos = (instanteUltimaVerificacion - instantePrimeraVerificacion) / 1000000.0;
+    Serial.printf("Carga de verificación %s: %lu PDUs de %u emisores, %.1f PDUs/s, %.1f %% del tiempo verificando\n", esquema.nombre,
+                  (unsigned long)latenciaOperacion.muestras, (unsigned)emisoresTopologiaCAN(), (latenciaOperacion.muestras - 1) / segundos,
+                  100.0 * latenciaOperacion.media * (latenciaOperacion.muestras - 1) / 1000000 / segundos);
+  }
+#endif
+#ifdef SALIDA_CSV
+  const char *nombreCSV = nombreBarridoBitrate(esquema.nombre);
+  latenciaOperacion.exportarCSV("DER", nombreCSV, "operacion");
+  obtenerRetrasoTransporteCAN().exportarCSV("DER", nombreCSV, "retraso_transporte");
+  obtenerHuecoTramasCAN().exportarCSV("DER", nombreCSV, "hueco_tramas");
+#endif
+  latenciaOperacion.reiniciar();
+  mostrarTraza(esquema.nombre, (NUM_REP + 1) * emisoresTopologiaCAN());
+  reiniciarTraza();
+  mostrarCopias(esquema.nombre, (NUM_REP + 1) * emisoresTopologiaCAN());
+  reiniciarCopias();
+  mostrarEstadisticasReceptorCAN(esquema.nombre);
+  reiniciarEstadisticasReceptorCAN();
+  mostrarEstadisticasTransporteCAN(esquema.nombre);
+  reiniciarEstadisticasTransporteCAN();
+  mostrarEstadisticasReservaCTR(esquema.nombre);
+  reiniciarEstadisticasReservaCTR();
+}
+
+#ifdef MODO_CANALIZADO
+// Estadísticas de la canalización del esquema en curso
+struct EstadisticasCanalizacion
+{
+  uint64_t instanteInicial;
+  uint64_t tiempoTotal;           // Duración de la medida del esquema en us
+  uint64_t tiempoCripto;          // Tiempo trabajando de la etapa criptográfica en us
+  uint64_t esperaProductor;       // Tiempo del productor esperando hueco en el anillo en us
+  uint64_t esperaConsumidor;      // Tiempo del consumidor esperando una PDU en el anillo en us
+  uint32_t sumatorioOcupacion;    // Suma de las PDUs en el anillo vistas por el consumidor
+  uint32_t ocupacionMaxima;
+  uint32_t muestras;
+};
+
+static AnilloSPSC<PDUCanalizada, LONGITUD_ANILLO_CANALIZACION> anilloCanalizacion;
+static EstadisticasCanalizacion estadisticasCanalizacion;
+static QueueHandle_t colaEtapas = NULL;     // Etapas encargadas a la tarea criptográfica
+static QueueHandle_t colaTerminadas = NULL; // Aviso de etapa terminada
+static TaskHandle_t tareaCripto = NULL;
+// Avisos para despertar a una etapa bloqueada esperando el anillo
+static QueueHandle_t avisoPublicada = NULL;
+static QueueHandle_t avisoLiberada = NULL;
+static std::atomic<bool> consumidorEsperando{false};
+static std::atomic<bool> productorEsperando{false};
+
+// Tarea de la etapa criptográfica: ejecuta las etapas que se le encargan
+static void hiloEtapaCripto(void *param)
+{
+  void (*etapa)();
+  while (true)
+  {
+    if (xQueueReceive(colaEtapas, &etapa, portMAX_DELAY) == pdTRUE)
+    {
+      etapa();
+      bool terminada = true;
+      xQueueSend(colaTerminadas, &terminada, portMAX_DELAY);
+    }
+  }
+}
+
+bool iniciarCanalizacion(BaseType_t nucleo)
+{
+  if (tareaCripto != NULL)
+  {
+    return true; // Ya estaba iniciada
+  }
+  colaEtapas = xQueueCreate(1, sizeof(void (*)()));
+  colaTerminadas = xQueueCreate(1, sizeof(bool));
+  avisoPublicada = xQueueCreate(1, sizeof(bool));
+  avisoLiberada = xQueueCreate(1, sizeof(bool));
+  if (colaEtapas == NULL || colaTerminadas == NULL || avisoPublicada == NULL || avisoLiberada == NULL)
+  {
+    return false;
+  }
+  return xTaskCreatePinnedToCore(hiloEtapaCripto, "EtapaCripto", 8192, NULL, PRIORIDAD_ETAPA_CRIPTO, &tareaCripto, nucleo) == pdPASS;
+}
+
+void lanzarEtapaCripto(void (*etapa)())
+{
+  xQueueSend(colaEtapas, &etapa, portMAX_DELAY);
+}
+
+void esperarEtapaCripto()
+{
+  bool terminada;
+  xQueueReceive(colaTerminadas, &terminada, portMAX_DELAY);
+}
+
+// Avisa a la otra etapa si está bloqueada esperando el anillo
+static void avisarEtapa(QueueHandle_t aviso, std::atomic<bool> &esperando)
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (esperando.load(std::memory_order_relaxed))
+  {
+    bool avisada = true;
+    xQueueSend(aviso, &avisada, 0);
+  }
+}
+
+// Espera a que la otra etapa mueva el anillo: primero espera activa corta y después
+// bloqueada hasta su aviso, así no se deja sin CPU a la tarea inactiva del núcleo
+template <class Condicion>
+static uint64_t esperarAnillo(Condicion intentar, QueueHandle_t aviso, std::atomic<bool> &esperando)
+{
+  uint64_t tiempoInicial = micros64();
+  while (!intentar())
+  {
+    if (micros64() - tiempoInicial < ESPERA_ACTIVA_CANALIZACION)
+    {
+      continue;
+    }
+    esperando.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // Volvemos a mirar después de anunciar la espera para no perder un aviso
+    if (!intentar())
+    {
+      bool avisada;
+      xQueueReceive(aviso, &avisada, 1);
+    }
+    esperando.store(false, std::memory_order_relaxed);
+  }
+  return micros64() - tiempoInicial;
+}
+
+PDUCanalizada *reservarPDUCanalizada()
+{
+  PDUCanalizada *hueco = anilloCanalizacion.reservar();
+  if (hueco == NULL)
+  {
+    estadisticasCanalizacion.esperaProductor += esperarAnillo([&hueco]()
+                                                              { return (hueco = anilloCanalizacion.reservar()) != NULL; },
+                                                              avisoLiberada, productorEsperando);
+  }
+  return hueco;
+}
+
+void publicarPDUCanalizada()
+{
+  anilloCanalizacion.publicar();
+  avisarEtapa(avisoPublicada, consumidorEsperando);
+}
+
+PDUCanalizada *siguientePDUCanalizada()
+{
+  PDUCanalizada *pdu = anilloCanalizacion.frente();
+  if (pdu == NULL)
+  {
+    estadisticasCanalizacion.esperaConsumidor += esperarAnillo([&pdu]()
+                                                               { return (pdu = anilloCanalizacion.frente()) != NULL; },
+                                                               avisoPublicada, consumidorEsperando);
+  }
+  uint32_t ocupacion = anilloCanalizacion.ocupacion();
+  estadisticasCanalizacion.sumatorioOcupacion += ocupacion;
+  if (ocupacion > estadisticasCanalizacion.ocupacionMaxima)
+  {
+    estadisticasCanalizacion.ocupacionMaxima = ocupacion;
+  }
+  estadisticasCanalizacion.muestras++;
+  return pdu;
+}
+
+void liberarPDUCanalizada()
+{
+  anilloCanalizacion.liberar();
+  avisarEtapa(avisoLiberada, productorEsperando);
+}
+
+void sumarTiempoEtapaCripto(uint64_t tiempo)
+{
+  estadisticasCanalizacion.tiempoCripto += tiempo;
+}
+
+void empezarCanalizacion()
+{
+  memset(&estadisticasCanalizacion, 0, sizeof(estadisticasCanalizacion));
+  estadisticasCanalizacion.instanteInicial = micros64();
+}
+
+void terminarCanalizacion()
+{
+  estadisticasCanalizacion.tiempoTotal = micros64() - estadisticasCanalizacion.instanteInicial;
+}
+
+void mostrarEstadisticasCanalizacion(const char *nombre, bool emisor)
+{
+  const EstadisticasCanalizacion &e = estadisticasCanalizacion;
+  double total = e.tiempoTotal;
+  // En el lado izquierdo produce la etapa criptográfica y consume la de E/S; en el derecho al revés
+  uint64_t esperaES = emisor ? e.esperaConsumidor : e.esperaProductor;
+  Serial.printf("Canalización %s: etapa criptográfica ocupada el %.1f %%, etapa de E/S ocupada el %.1f %%\n", nombre,
+                100.0 * e.tiempoCripto / total, 100.0 * (total - esperaES) / total);
+  Serial.printf("Canalización %s: ocupación media del anillo %.2f de %lu (máxima %lu), %f mensajes/s\n", nombre,
+                e.muestras > 0 ? (double)e.sumatorioOcupacion / e.muestras : 0.0, (unsigned long)LONGITUD_ANILLO_CANALIZACION,
+                (unsigned long)e.ocupacionMaxima, (NUM_REP + 1) * 1000000.0 / total);
+}
+#endif
+
+#ifdef MODO_CAUDAL
+// Números de secuencia distintos, los de un byte
+const uint16_t SECUENCIAS_CAUDAL = 256;
+
+// Estado del punto de la curva en curso
+struct PuntoCaudal
+{
+  uint64_t instanteInicial;
+  uint64_t instanteUltimaRespuesta;
+  uint64_t instantePrevisto[SECUENCIAS_CAUDAL]; // De cada mensaje en vuelo, por número de secuencia
+  bool enVuelo[SECUENCIAS_CAUDAL];
+  uint32_t mensajesEnVuelo;
+  uint32_t enviados;
+  uint32_t respondidos;
+  uint32_t fallidos; // Respuestas con la verificación fallida
+  uint32_t perdidos; // Mensajes sin respuesta
+  uint64_t tiempoBusRespuestas;
+};
+
+static PuntoCaudal puntoCaudal;
+static HistogramaLatencia latenciaCaudal;
+// Tiempo en el bus de un mensaje con su respuesta y sus controles de flujo, en us
+static uint64_t tiempoBusMensajeCaudal = 1;
+
+// Cuenta la respuesta de un mensaje en vuelo. Se llama desde el bucle de envío y desde el
+// transporte cuando la respuesta llega mientras espera un control de flujo
+static void procesarRespuestaCaudal(const twai_message_t &mensaje)
+{
+  if (mensaje.data_length_code != LONGITUD_MENSAJE_CAN)
+  {
+    return;
+  }
+  uint8_t secuencia = mensaje.data[7];
+  if (!puntoCaudal.enVuelo[secuencia])
+  {
+    return; // Respuesta de un mensaje ya dado por perdido
+  }
+  uint64_t instanteLlegada = instanteLlegadaCAN();
+  puntoCaudal.enVuelo[secuencia] = false;
+  puntoCaudal.mensajesEnVuelo--;
+  puntoCaudal.respondidos++;
+  if (mensaje.data[0] != RESPUESTA_VERIFICADA)
+  {
+    puntoCaudal.fallidos++;
+  }
+  latenciaCaudal.anotar(instanteLlegada - puntoCaudal.instantePrevisto[secuencia]);
+  puntoCaudal.tiempoBusRespuestas += tiempoBusMensajeCAN(mensaje);
+  puntoCaudal.instanteUltimaRespuesta = instanteLlegada;
+}
+
+static void darPorPerdidosCaudal()
+{
+  memset(puntoCaudal.enVuelo, 0, sizeof(puntoCaudal.enVuelo));
+  puntoCaudal.perdidos += puntoCaudal.mensajesEnVuelo;
+  puntoCaudal.mensajesEnVuelo = 0;
+}
+
+// Atiende una respuesta si llega en la espera indicada. Devuelve false si no ha llegado
+static bool atenderRespuestaCaudal(TickType_t espera)
+{
+  mensajeCANLeido = leerMensajeCAN(espera);
+  if (mensajeCANLeido == NULL)
+  {
+    return false;
+  }
+  procesarRespuestaCaudal(*mensajeCANLeido);
+  return true;
+}
+
+void calibrarCaudal(const DescriptorEsquema &esquema, const uint8_t *pdu, uint16_t longitud)
+{
+  RespuestaBenchmark respuesta;
+  enviarPDU(pdu, longitud);
+  uint64_t tiempoBus = obtenerUltimaTransferencia().tiempoBus;
+  recibirRespuesta(&respuesta);
+  tiempoBusMensajeCaudal = tiempoBus + tiempoBusMensajeCAN(*mensajeCANLeido);
+  Serial.printf("Caudal %s: %.1f us de bus por mensaje con su respuesta (%.1f mensajes/s al 100 %%), ventana de %u mensajes\n",
+                esquema.nombre, (double)tiempoBusMensajeCaudal, 1000000.0 / tiempoBusMensajeCaudal, (unsigned)VENTANA_CAUDAL);
+}
+
+uint64_t empezarPuntoCaudal(uint16_t carga)
+{
+  memset(&puntoCaudal, 0, sizeof(puntoCaudal));
+  latenciaCaudal.reiniciar();
+  reiniciarEstadisticasReceptorCAN();
+  reiniciarEstadisticasTransporteCAN();
+  reiniciarEstadisticasReservaCTR();
+  desviarMensajesTransporteCAN(&procesarRespuestaCaudal);
+  puntoCaudal.instanteInicial = micros64();
+  uint64_t periodo = tiempoBusMensajeCaudal * 100 / carga;
+  return periodo > 0 ? periodo : 1;
+}
+
+void esperarTurnoCaudal(uint64_t instante)
+{
+  uint64_t ultimaActividad = micros64();
+  while (puntoCaudal.mensajesEnVuelo >= VENTANA_CAUDAL || micros64() < instante)
+  {
+    // Con la ventana llena cedemos la CPU hasta la siguiente respuesta; si no, vigilamos el instante previsto
+    bool llena = puntoCaudal.mensajesEnVuelo >= VENTANA_CAUDAL;
+    if (atenderRespuestaCaudal(llena ? 1 : 0))
+    {
+      ultimaActividad = micros64();
+    }
+    else if (llena && micros64() - ultimaActividad > ESPERA_MAXIMA_CAUDAL)
+    {
+      darPorPerdidosCaudal();
+    }
+  }
+}
+
+void anotarEnvioCaudal(uint64_t instantePrevisto)
+{
+  // El lado derecho numera igual: desde cero en cada punto
+  uint8_t secuencia = puntoCaudal.enviados;
+  puntoCaudal.instantePrevisto[secuencia] = instantePrevisto;
+  puntoCaudal.enVuelo[secuencia] = true;
+  puntoCaudal.mensajesEnVuelo++;
+  puntoCaudal.enviados++;
+}
+
+void terminarPuntoCaudal(const DescriptorEsquema &esquema, uint16_t carga)
+{
+  uint64_t ultimaActividad = micros64();
+  while (puntoCaudal.mensajesEnVuelo > 0)
+  {
+    if (atenderRespuestaCaudal(1))
+    {
+      ultimaActividad = micros64();
+    }
+    else if (micros64() - ultimaActividad > ESPERA_MAXIMA_CAUDAL)
+    {
+      darPorPerdidosCaudal();
+    }
+  }
+  desviarMensajesTransporteCAN(NULL);
+  const EstadisticasTransporteCAN &transporte = obtenerEstadisticasTransporteCAN();
+  uint64_t instanteFinal = puntoCaudal.respondidos > 0 ? puntoCaudal.instanteUltimaRespuesta : micros64();
+  double segundos = (instanteFinal - puntoCaudal.instanteInicial) / 1000000.0;
+  // Tramas de datos y controles de flujo del transporte y las respuestas
+  double tramas = transporte.tramas + transporte.tramasControl + puntoCaudal.respondidos;
+  double tiempoBus = transporte.sumatorioTiempoBus + puntoCaudal.tiempoBusRespuestas;
+  Serial.printf("Caudal %s al %u %%: ofrecidos %.1f mensajes/s, conseguidos %.1f mensajes/s y %.1f tramas/s, bus ocupado el %.1f %%\n",
+                esquema.nombre, (unsigned)carga, 1000000.0 * carga / 100 / tiempoBusMensajeCaudal, puntoCaudal.respondidos / segundos,
+                tramas / segundos, 100.0 * tiempoBus / 1000000 / segundos);
+  Serial.printf("Caudal %s al %u %%: latencia media %f ms, p50 %f ms, p99 %f ms, máxima %f ms, %lu verificaciones fallidas, %lu perdidos\n",
+                esquema.nombre, (unsigned)carga, latenciaCaudal.media / 1000, latenciaCaudal.percentil(50) / 1000.0,
+                latenciaCaudal.percentil(99) / 1000.0, latenciaCaudal.maximo / 1000.0, (unsigned long)puntoCaudal.fallidos,
+                (unsigned long)puntoCaudal.perdidos);
+#ifdef SALIDA_CSV
+  char magnitud[16];
+  snprintf(magnitud, sizeof(magnitud), "carga_%u", (unsigned)carga);
+  latenciaCaudal.exportarCSV("IZQ", esquema.nombre, magnitud);
+#endif
+}
+#endif
@@ -0,0 +1,95 @@
+#include <Arduino.h>
+#include "MotorCMAC.h"
+#include "CacheAES.h"
+
+// Constante de reducción para bloques de 128 bits
+const uint8_t RB_CMAC = 0x87;
+
+static ContextoCMAC contextosCMAC[MAX_CONTEXTOS_CMAC];
+static uint8_t numeroContextosCMAC = 0;
+
+// Desplaza el bloque un bit a la izquierda y reduce si se sale el bit más alto
+static void duplicarSubclave(const uint8_t *entrada, uint8_t *salida)
+{
+  uint8_t acarreo = 0;
+  for (int8_t i = LONGITUD_BLOQUE_CMAC - 1; i >= 0; i--)
+  {
+    uint8_t byte = entrada[i];
+    salida[i] = (byte << 1) | acarreo;
+    acarreo = byte >> 7;
+  }
+  if (entrada[0] & 0x80)
+  {
+    salida[LONGITUD_BLOQUE_CMAC - 1] ^= RB_CMAC;
+  }
+}
+
+const ContextoCMAC *obtenerContextoCMAC(const uint8_t *clave, uint16_t bits)
+{
+  // Buscamos si ya existe el contexto
+  for (uint8_t i = 0; i < numeroContextosCMAC; i++)
+  {
+    if (contextosCMAC[i].clave == clave && contextosCMAC[i].bits == bits)
+    {
+      return &contextosCMAC[i];
+    }
+  }
+  if (numeroContextosCMAC >= MAX_CONTEXTOS_CMAC)
+  {
+    return NULL;
+  }
+  // El cifrador es el de la caché, así que la clave sólo se expande si nadie lo había hecho
+  mbedtls_aes_context *cifrador = obtenerContextoAES(clave, bits, MBEDTLS_AES_ENCRYPT);
+  if (cifrador == NULL)
+  {
+    return NULL;
+  }
+  ContextoCMAC &contexto = contextosCMAC[numeroContextosCMAC];
+  unsigned long tiempoInicial = micros();
+  // L = AES(K, 0), K1 = 2L y K2 = 4L en GF(2^128)
+  uint8_t ceros[LONGITUD_BLOQUE_CMAC] = {0};
+  uint8_t l[LONGITUD_BLOQUE_CMAC];
+  mbedtls_aes_crypt_ecb(cifrador, MBEDTLS_AES_ENCRYPT, ceros, l);
+  duplicarSubclave(l, contexto.k1);
+  duplicarSubclave(contexto.k1, contexto.k2);
+  contexto.tiempoSubclaves = micros() - tiempoInicial;
+  contexto.clave = clave;
+  contexto.bits = bits;
+  contexto.cifrador = cifrador;
+  numeroContextosCMAC++;
+  return &contexto;
+}
+
+void calcularCMAC(const ContextoCMAC *contexto, const uint8_t *datos, size_t longitud, uint8_t *mac)
+{
+  uint8_t bloque[LONGITUD_BLOQUE_CMAC];
+  // Todos los bloques menos el último se encadenan tal cual
+  size_t bloquesCompletos = longitud == 0 ? 0 : (longitud - 1) / LONGITUD_BLOQUE_CMAC;
+  memset(mac, 0, LONGITUD_BLOQUE_CMAC);
+  for (size_t b = 0; b < bloquesCompletos; b++)
+  {
+    for (uint8_t i = 0; i < LONGITUD_BLOQUE_CMAC; i++)
+    {
+      bloque[i] = mac[i] ^ datos[b * LONGITUD_BLOQUE_CMAC + i];
+    }
+    mbedtls_aes_crypt_ecb(contexto->cifrador, MBEDTLS_AES_ENCRYPT, bloque, mac);
+  }
+  // El último bloque se combina con K1 si está completo o se rellena con 10...0 y se combina con K2
+  size_t resto = longitud - bloquesCompletos * LONGITUD_BLOQUE_CMAC;
+  const uint8_t *ultimo = datos + bloquesCompletos * LONGITUD_BLOQUE_CMAC;
+  const uint8_t *subclave = resto == LONGITUD_BLOQUE_CMAC ? contexto->k1 : contexto->k2;
+  for (uint8_t i = 0; i < LONGITUD_BLOQUE_CMAC; i++)
+  {
+    uint8_t byte = i < resto ? ultimo[i] : (i == resto ? 0x80 : 0x00);
+    bloque[i] = mac[i] ^ byte ^ subclave[i];
+  }
+  mbedtls_aes_crypt_ecb(contexto->cifrador, MBEDTLS_AES_ENCRYPT, bloque, mac);
+}
+
+void mostrarCosteCMAC()
+{
+  for (uint8_t i = 0; i < numeroContextosCMAC; i++)
+  {
+    Serial.printf("Contexto CMAC AES-%u: subclaves K1 y K2 %lu us\n", contextosCMAC[i].bits, contextosCMAC[i].tiempoSubclaves);
+  }
+}
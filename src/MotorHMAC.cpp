@@ -0,0 +1,145 @@
+#include <Arduino.h>
+#include "MotorHMAC.h"
+#include "MotorBenchmark.h"
+#include "TrazaCiclos.h"
+
+// Bytes con los que se combina la clave para el resumen interno y el externo
+const uint8_t IPAD_HMAC = 0x36;
+const uint8_t OPAD_HMAC = 0x5C;
+
+static ContextoHMAC contextosHMAC[MAX_CONTEXTOS_HMAC];
+static uint8_t numeroContextosHMAC = 0;
+
+// Longitud del bloque de la función resumen: 128 bytes en SHA-384 y SHA-512 y 64 en el resto
+static uint8_t bloqueResumen(mbedtls_md_type_t tipo)
+{
+  return tipo == MBEDTLS_MD_SHA384 || tipo == MBEDTLS_MD_SHA512 ? 128 : 64;
+}
+
+// Deja en estado el resumen del bloque de la clave combinada con relleno, que es una compresión
+static int resumirBloqueClave(mbedtls_md_context_t *estado, const uint8_t *clave, uint8_t longitudClave, uint8_t bloque, uint8_t relleno)
+{
+  uint8_t combinada[128];
+  memset(combinada, relleno, bloque);
+  for (uint8_t i = 0; i < longitudClave; i++)
+  {
+    combinada[i] ^= clave[i];
+  }
+  int resultado = mbedtls_md_starts(estado);
+  if (resultado == 0)
+  {
+    resultado = mbedtls_md_update(estado, combinada, bloque);
+  }
+  return resultado;
+}
+
+ContextoHMAC *obtenerContextoHMAC(mbedtls_md_type_t tipo, const uint8_t *clave, uint8_t longitudClave)
+{
+  // Buscamos si ya existe el contexto
+  for (uint8_t i = 0; i < numeroContextosHMAC; i++)
+  {
+    if (contextosHMAC[i].clave == clave && contextosHMAC[i].longitudClave == longitudClave && contextosHMAC[i].tipo == tipo)
+    {
+      return &contextosHMAC[i];
+    }
+  }
+  const mbedtls_md_info_t *informacion = mbedtls_md_info_from_type(tipo);
+  if (numeroContextosHMAC >= MAX_CONTEXTOS_HMAC || informacion == NULL)
+  {
+    return NULL;
+  }
+  ContextoHMAC &contexto = contextosHMAC[numeroContextosHMAC];
+  mbedtls_md_init(&contexto.interno);
+  mbedtls_md_init(&contexto.externo);
+  mbedtls_md_init(&contexto.trabajo);
+  mbedtls_md_init(&contexto.completo);
+  // Los contextos se reservan aquí, así que la medida no reserva memoria
+  if (mbedtls_md_setup(&contexto.interno, informacion, 0) != 0 || mbedtls_md_setup(&contexto.externo, informacion, 0) != 0 ||
+      mbedtls_md_setup(&contexto.trabajo, informacion, 0) != 0 || mbedtls_md_setup(&contexto.completo, informacion, 1) != 0)
+  {
+    mbedtls_md_free(&contexto.interno);
+    mbedtls_md_free(&contexto.externo);
+    mbedtls_md_free(&contexto.trabajo);
+    mbedtls_md_free(&contexto.completo);
+    return NULL;
+  }
+  unsigned long tiempoInicial = micros();
+  // Una clave más larga que el bloque se sustituye por su resumen
+  uint8_t bloque = bloqueResumen(tipo);
+  uint8_t claveBloque[MBEDTLS_MD_MAX_SIZE];
+  const uint8_t *claveUsada = clave;
+  uint8_t longitudUsada = longitudClave;
+  if (longitudClave > bloque)
+  {
+    mbedtls_md(informacion, clave, longitudClave, claveBloque);
+    claveUsada = claveBloque;
+    longitudUsada = mbedtls_md_get_size(informacion);
+  }
+  if (resumirBloqueClave(&contexto.interno, claveUsada, longitudUsada, bloque, IPAD_HMAC) != 0 ||
+      resumirBloqueClave(&contexto.externo, claveUsada, longitudUsada, bloque, OPAD_HMAC) != 0)
+  {
+    mbedtls_md_free(&contexto.interno);
+    mbedtls_md_free(&contexto.externo);
+    mbedtls_md_free(&contexto.trabajo);
+    mbedtls_md_free(&contexto.completo);
+    return NULL;
+  }
+  contexto.tiempoPrecalculo = micros() - tiempoInicial;
+  contexto.clave = clave;
+  contexto.longitudClave = longitudClave;
+  contexto.tipo = tipo;
+  contexto.longitudResumen = mbedtls_md_get_size(informacion);
+  numeroContextosHMAC++;
+  return &contexto;
+}
+
+void calcularHMAC(ContextoHMAC *contexto, const uint8_t *datos, size_t longitud, uint8_t *mac)
+{
+  uint8_t resumenInterno[MBEDTLS_MD_MAX_SIZE];
+  // Resumen interno: continúa desde K ^ ipad
+  mbedtls_md_clone(&contexto->trabajo, &contexto->interno);
+  sondaTraza(FASE_CLAVE);
+  mbedtls_md_update(&contexto->trabajo, datos, longitud);
+  mbedtls_md_finish(&contexto->trabajo, resumenInterno);
+  // Resumen externo: continúa desde K ^ opad con el resumen interno
+  mbedtls_md_clone(&contexto->trabajo, &contexto->externo);
+  mbedtls_md_update(&contexto->trabajo, resumenInterno, contexto->longitudResumen);
+  mbedtls_md_finish(&contexto->trabajo, mac);
+}
+
+void calcularHMACSinPrecalculo(ContextoHMAC *contexto, const uint8_t *datos, size_t longitud, uint8_t *mac)
+{
+  mbedtls_md_hmac_starts(&contexto->completo, contexto->clave, contexto->longitudClave);
+  sondaTraza(FASE_CLAVE);
+  mbedtls_md_hmac_update(&contexto->completo, datos, longitud);
+  mbedtls_md_hmac_finish(&contexto->completo, mac);
+}
+
+// Coste medio en us de un MAC de los datos con el cálculo indicado
+static double medirCosteHMAC(ContextoHMAC *contexto, void (*calcular)(ContextoHMAC *, const uint8_t *, size_t, uint8_t *))
+{
+  uint8_t datos[LONGITUD_MENSAJE_CAN] = {0};
+  uint8_t mac[MBEDTLS_MD_MAX_SIZE];
+  uint64_t tiempoInicial = micros64();
+  for (uint16_t i = 0; i < REPETICIONES_COSTE_HMAC; i++)
+  {
+    datos[0] = i; // Cada mensaje distinto, como en la medida
+    calcular(contexto, datos, sizeof(datos), mac);
+  }
+  return (double)(micros64() - tiempoInicial) / REPETICIONES_COSTE_HMAC;
+}
+
+void mostrarCosteHMAC()
+{
+  for (uint8_t i = 0; i < numeroContextosHMAC; i++)
+  {
+    ContextoHMAC *contexto = &contextosHMAC[i];
+    double conPrecalculo = medirCosteHMAC(contexto, calcularHMAC);
+    double sinPrecalculo = medirCosteHMAC(contexto, calcularHMACSinPrecalculo);
+    Serial.printf("Contexto HMAC-%s: estados de ipad y opad %lu us; MAC de %u bytes %.2f us con ellos y %.2f us sin ellos (%.1f veces)\n",
+                  mbedtls_md_get_name(mbedtls_md_info_from_type(contexto->tipo)), contexto->tiempoPrecalculo, (unsigned)LONGITUD_MENSAJE_CAN,
+                  conPrecalculo, sinPrecalculo, conPrecalculo > 0 ? sinPrecalculo / conPrecalculo : 0);
+  }
+  // Las sondas de estas medidas no son de ninguna iteración
+  reiniciarTraza();
+}
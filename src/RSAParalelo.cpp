@@ -0,0 +1,182 @@
+#include "RSAParalelo.h"
+#include "GeneradorAleatorio.h"
+
+// Bytes aleatorios del múltiplo de (P - 1) que se suma al exponente, los mismos que en mbedtls
+static const uint8_t BYTES_CEGADO_EXPONENTE = 28;
+// Intentos máximos para encontrar un Vf invertible
+static const uint8_t INTENTOS_CEGADO = 10;
+
+// Exponenciación modular de una de las dos mitades del CRT
+struct MitadCRT
+{
+  mbedtls_mpi resultado;
+  const mbedtls_mpi *base;
+  const mbedtls_mpi *exponente;
+  const mbedtls_mpi *modulo;
+  mbedtls_mpi *constanteMontgomery; // RP o RQ del contexto, sólo la usa la tarea que calcula esa mitad
+  int error;
+};
+
+static TaskHandle_t tareaMitad = NULL;
+static QueueHandle_t colaMitades = NULL;      // Mitades que tiene que calcular la tarea
+static QueueHandle_t colaMitadesHechas = NULL; // Mitades ya calculadas
+
+static void calcularMitad(MitadCRT &mitad)
+{
+  mitad.error = mbedtls_mpi_exp_mod(&mitad.resultado, mitad.base, mitad.exponente, mitad.modulo, mitad.constanteMontgomery);
+}
+
+// Tarea del otro núcleo: espera una mitad, la calcula y la devuelve
+static void hiloMitad(void *param)
+{
+  MitadCRT *mitad;
+  while (true)
+  {
+    if (xQueueReceive(colaMitades, &mitad, portMAX_DELAY) == pdTRUE)
+    {
+      calcularMitad(*mitad);
+      xQueueSend(colaMitadesHechas, &mitad, portMAX_DELAY);
+    }
+  }
+}
+
+bool iniciarRSAParalelo(BaseType_t nucleo)
+{
+  if (tareaMitad != NULL)
+  {
+    return true;
+  }
+  colaMitades = xQueueCreate(1, sizeof(MitadCRT *));
+  colaMitadesHechas = xQueueCreate(1, sizeof(MitadCRT *));
+  if (colaMitades == NULL || colaMitadesHechas == NULL)
+  {
+    return false;
+  }
+  return xTaskCreatePinnedToCore(hiloMitad, "MitadRSA", 4096, NULL, PRIORIDAD_TAREA_RSA, &tareaMitad, nucleo) == pdPASS;
+}
+
+// Prepara el par de cegado con Vi = Vf^-E mod N. Como en mbedtls, la primera vez Vf es aleatorio
+// y en las siguientes se elevan los dos al cuadrado, que es mucho más barato
+static int prepararCegado(mbedtls_rsa_context *contexto)
+{
+  int ret;
+  uint8_t intentos = 0;
+  mbedtls_mpi divisor;
+  mbedtls_mpi_init(&divisor);
+  if (contexto->Vf.p != NULL)
+  {
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&contexto->Vi, &contexto->Vi, &contexto->Vi));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&contexto->Vi, &contexto->Vi, &contexto->N));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&contexto->Vf, &contexto->Vf, &contexto->Vf));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&contexto->Vf, &contexto->Vf, &contexto->N));
+    goto cleanup;
+  }
+  do
+  {
+    if (++intentos > INTENTOS_CEGADO)
+    {
+      ret = MBEDTLS_ERR_RSA_RNG_FAILED;
+      goto cleanup;
+    }
+    MBEDTLS_MPI_CHK(mbedtls_mpi_fill_random(&contexto->Vf, contexto->len - 1, generarAleatorio, NULL));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_gcd(&divisor, &contexto->Vf, &contexto->N));
+  } while (mbedtls_mpi_cmp_int(&divisor, 1) != 0);
+  MBEDTLS_MPI_CHK(mbedtls_mpi_inv_mod(&contexto->Vi, &contexto->Vf, &contexto->N));
+  MBEDTLS_MPI_CHK(mbedtls_mpi_exp_mod(&contexto->Vi, &contexto->Vi, &contexto->E, &contexto->N, &contexto->RN));
+cleanup:
+  mbedtls_mpi_free(&divisor);
+  return ret;
+}
+
+// exponenteCegado = exponente + R·(primo - 1) con R aleatorio, que da el mismo resultado módulo primo
+static int cegarExponente(mbedtls_mpi *exponenteCegado, const mbedtls_mpi *exponente, const mbedtls_mpi *primo)
+{
+  int ret;
+  mbedtls_mpi aleatorio, primoMenosUno;
+  mbedtls_mpi_init(&aleatorio);
+  mbedtls_mpi_init(&primoMenosUno);
+  MBEDTLS_MPI_CHK(mbedtls_mpi_fill_random(&aleatorio, BYTES_CEGADO_EXPONENTE, generarAleatorio, NULL));
+  MBEDTLS_MPI_CHK(mbedtls_mpi_sub_int(&primoMenosUno, primo, 1));
+  MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(exponenteCegado, &aleatorio, &primoMenosUno));
+  MBEDTLS_MPI_CHK(mbedtls_mpi_add_mpi(exponenteCegado, exponenteCegado, exponente));
+cleanup:
+  mbedtls_mpi_free(&aleatorio);
+  mbedtls_mpi_free(&primoMenosUno);
+  return ret;
+}
+
+int privadaRSAParalela(mbedtls_rsa_context *contexto, const unsigned char *entrada, unsigned char *salida)
+{
+  int ret;
+  int errorQ;
+  bool enParalelo;
+  MitadCRT mitadP;
+  MitadCRT *pendiente = &mitadP;
+  mbedtls_mpi base, original, mitadQ, exponenteP, exponenteQ;
+  mbedtls_mpi_init(&base);
+  mbedtls_mpi_init(&original);
+  mbedtls_mpi_init(&mitadQ);
+  mbedtls_mpi_init(&exponenteP);
+  mbedtls_mpi_init(&exponenteQ);
+  mbedtls_mpi_init(&mitadP.resultado);
+  MBEDTLS_MPI_CHK(mbedtls_mpi_read_binary(&base, entrada, contexto->len));
+  if (mbedtls_mpi_cmp_mpi(&base, &contexto->N) >= 0)
+  {
+    ret = MBEDTLS_ERR_MPI_BAD_INPUT_DATA;
+    goto cleanup;
+  }
+  MBEDTLS_MPI_CHK(mbedtls_mpi_copy(&original, &base));
+
+  // Cegado de la base (base·Vi mod N) y de los dos exponentes
+  MBEDTLS_MPI_CHK(prepararCegado(contexto));
+  MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&base, &base, &contexto->Vi));
+  MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&base, &base, &contexto->N));
+  MBEDTLS_MPI_CHK(cegarExponente(&exponenteP, &contexto->DP, &contexto->P));
+  MBEDTLS_MPI_CHK(cegarExponente(&exponenteQ, &contexto->DQ, &contexto->Q));
+
+  // base^DP mod P en la otra tarea y base^DQ mod Q en esta, a la vez. Las dos sólo leen la base
+  mitadP.base = &base;
+  mitadP.exponente = &exponenteP;
+  mitadP.modulo = &contexto->P;
+  mitadP.constanteMontgomery = &contexto->RP;
+  enParalelo = tareaMitad != NULL && xQueueSend(colaMitades, &pendiente, 0) == pdTRUE;
+  errorQ = mbedtls_mpi_exp_mod(&mitadQ, &base, &exponenteQ, &contexto->Q, &contexto->RQ);
+  if (enParalelo)
+  {
+    xQueueReceive(colaMitadesHechas, &pendiente, portMAX_DELAY);
+  }
+  else
+  {
+    calcularMitad(mitadP);
+  }
+  MBEDTLS_MPI_CHK(errorQ);
+  MBEDTLS_MPI_CHK(mitadP.error);
+
+  // Recombinación de Garner: base = mitadQ + Q·((mitadP - mitadQ)·QP mod P)
+  MBEDTLS_MPI_CHK(mbedtls_mpi_sub_mpi(&base, &mitadP.resultado, &mitadQ));
+  MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&base, &base, &contexto->QP));
+  MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&base, &base, &contexto->P));
+  MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&base, &base, &contexto->Q));
+  MBEDTLS_MPI_CHK(mbedtls_mpi_add_mpi(&base, &base, &mitadQ));
+
+  // Quitamos el cegado: base·Vf mod N
+  MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&base, &base, &contexto->Vf));
+  MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&base, &base, &contexto->N));
+
+  // Como mbedtls, comprobamos el resultado con la clave pública para no dejar salir uno erróneo
+  MBEDTLS_MPI_CHK(mbedtls_mpi_exp_mod(&mitadQ, &base, &contexto->E, &contexto->N, &contexto->RN));
+  if (mbedtls_mpi_cmp_mpi(&mitadQ, &original) != 0)
+  {
+    ret = MBEDTLS_ERR_RSA_PRIVATE_FAILED;
+    goto cleanup;
+  }
+  MBEDTLS_MPI_CHK(mbedtls_mpi_write_binary(&base, salida, contexto->len));
+cleanup:
+  mbedtls_mpi_free(&base);
+  mbedtls_mpi_free(&original);
+  mbedtls_mpi_free(&mitadQ);
+  mbedtls_mpi_free(&exponenteP);
+  mbedtls_mpi_free(&exponenteQ);
+  mbedtls_mpi_free(&mitadP.resultado);
+  return ret;
+}
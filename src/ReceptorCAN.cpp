@@ -0,0 +1,216 @@
+#include "ReceptorCAN.h"
+#include "TrazaCiclos.h"
+#include "ContadorCopias.h"
+#include <freertos/queue.h>
+#include <atomic>
+
+static EstadisticasReceptorCAN estadisticasRecepcion;
+// Instante en que llegó el último mensaje entregado
+static uint64_t instanteUltimaLlegada = 0;
+static bool (*filtroMensajes)(const twai_message_t &mensaje) = NULL;
+
+#ifndef RECEPCION_POR_SONDEO
+// Mensaje entregado por la tarea receptora junto con el instante en que lo sacó del driver
+struct MensajeRecibido
+{
+  twai_message_t mensaje;
+  uint64_t instanteLlegada;
+};
+
+// Huecos donde el driver deja los mensajes: los que caben en la cola, el que tiene el consumidor
+// desde su última lectura y el que está llenando la tarea, así la tarea nunca pisa uno en uso
+const uint16_t HUECOS_RECEPCION = LONGITUD_COLA_RECEPCION + 2;
+static MensajeRecibido huecosRecepcion[HUECOS_RECEPCION];
+// Índices de los huecos con un mensaje entregado, en orden de llegada
+static QueueHandle_t colaRecepcion = NULL;
+static TaskHandle_t tareaRecepcion = NULL;
+// Pausa pedida por quien va a reinstalar el driver, y confirmada por la tarea receptora
+static std::atomic<bool> pausaSolicitada{false};
+static std::atomic<bool> tareaEnPausa{false};
+
+// Pasa el hueco por la cola. Con la cola llena espera a que el consumidor saque alguno, pero cada
+// ESPERA_TAREA_RECEPCION mira si se ha pedido una pausa: entonces descarta el mensaje, como la pausa
+// descarta los que siguen en la cola, para poder confirmarla. Devuelve false si lo ha descartado
+static bool entregarHueco(uint16_t hueco)
+{
+  while (xQueueSend(colaRecepcion, &hueco, ESPERA_TAREA_RECEPCION) != pdTRUE)
+  {
+    if (pausaSolicitada.load())
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Tarea que se queda bloqueada en el driver y pasa por la cola el hueco de cada mensaje
+static void hiloRecepcion(void *param)
+{
+  uint16_t hueco = 0;
+  while (true)
+  {
+    if (pausaSolicitada.load())
+    {
+      tareaEnPausa = true; // Fuera del driver, que se puede desinstalar
+      vTaskDelay(1);
+      continue;
+    }
+    tareaEnPausa = false;
+    // Bloqueado en el driver hasta que llega un mensaje, sin consumir CPU. El driver lo deja en el hueco
+    MensajeRecibido &recibido = huecosRecepcion[hueco];
+    esp_err_t resultado = twai_receive(&recibido.mensaje, ESPERA_TAREA_RECEPCION);
+    if (resultado == ESP_OK)
+    {
+      recibido.instanteLlegada = micros64();
+      if ((filtroMensajes == NULL || filtroMensajes(recibido.mensaje)) && entregarHueco(hueco))
+      {
+        hueco = (hueco + 1) % HUECOS_RECEPCION;
+      }
+    }
+    else if (resultado != ESP_ERR_TIMEOUT)
+    {
+      vTaskDelay(1); // El driver no está instalado o está parado, esperamos a que vuelva
+    }
+  }
+}
+#else
+// Mensaje que deja el driver en cada sondeo
+static twai_message_t mensajeSondeo;
+#endif
+
+bool iniciarReceptorCAN(BaseType_t nucleo)
+{
+  reiniciarEstadisticasReceptorCAN();
+#ifdef RECEPCION_POR_SONDEO
+  return true;
+#else
+  if (tareaRecepcion != NULL)
+  {
+    return true; // Ya estaba iniciado
+  }
+  colaRecepcion = xQueueCreate(LONGITUD_COLA_RECEPCION, sizeof(uint16_t));
+  if (colaRecepcion == NULL)
+  {
+    return false;
+  }
+  return xTaskCreatePinnedToCore(hiloRecepcion, "RecepcionCAN", 4096, NULL, PRIORIDAD_TAREA_RECEPCION, &tareaRecepcion, nucleo) == pdPASS;
+#endif
+}
+
+const twai_message_t *leerMensajeCAN(TickType_t espera)
+{
+#ifdef RECEPCION_POR_SONDEO
+  twai_message_t *mensaje = &mensajeSondeo;
+  uint32_t sondeos = 0;
+  unsigned long tiempoInicial = micros();
+  // Espera activa, como en la versión original. Los mensajes que no pasan el filtro cuentan como sondeos vacíos
+  while (twai_receive(mensaje, pdMS_TO_TICKS(0)) != ESP_OK || (filtroMensajes != NULL && !filtroMensajes(*mensaje)))
+  {
+    sondeos++;
+    if (espera != portMAX_DELAY && (micros() - tiempoInicial) / 1000 >= espera * portTICK_PERIOD_MS)
+    {
+      estadisticasRecepcion.tiempoEsperaActiva += micros() - tiempoInicial;
+      estadisticasRecepcion.sondeos += sondeos;
+      return NULL;
+    }
+  }
+  unsigned long tiempoEspera = micros() - tiempoInicial;
+  instanteUltimaLlegada = micros64();
+  // El mensaje llegó en algún momento del último sondeo, así que la latencia estimada es medio periodo de sondeo
+  unsigned long latencia = tiempoEspera / (sondeos + 1) / 2;
+  estadisticasRecepcion.tiempoEsperaActiva += tiempoEspera;
+  estadisticasRecepcion.sondeos += sondeos;
+#else
+  uint16_t hueco;
+  unsigned long tiempoInicial = micros();
+  // Bloqueados en la cola, la CPU queda libre para otras tareas
+  if (xQueueReceive(colaRecepcion, &hueco, espera) != pdTRUE)
+  {
+    estadisticasRecepcion.tiempoCedido += micros() - tiempoInicial;
+    return NULL;
+  }
+  unsigned long tiempoFinal = micros();
+  estadisticasRecepcion.tiempoCedido += tiempoFinal - tiempoInicial;
+  const MensajeRecibido &recibido = huecosRecepcion[hueco];
+  const twai_message_t *mensaje = &recibido.mensaje;
+  instanteUltimaLlegada = recibido.instanteLlegada;
+  // Tiempo desde que la tarea receptora sacó el mensaje del driver hasta que lo tenemos aquí
+  unsigned long latencia = micros64() - recibido.instanteLlegada;
+#endif
+  estadisticasRecepcion.mensajes++;
+  estadisticasRecepcion.sumatorioLatencia += latencia;
+  if (latencia > estadisticasRecepcion.latenciaMaxima)
+  {
+    estadisticasRecepcion.latenciaMaxima = latencia;
+  }
+  return mensaje;
+}
+
+bool recibirMensajeCAN(twai_message_t *mensaje, TickType_t espera)
+{
+  const twai_message_t *leido = leerMensajeCAN(espera);
+  if (leido == NULL)
+  {
+    return false;
+  }
+  *mensaje = *leido;
+  contarCopia(COPIA_RECEPCION, sizeof(*mensaje));
+  return true;
+}
+
+uint64_t instanteLlegadaCAN()
+{
+  return instanteUltimaLlegada;
+}
+
+void filtrarMensajesCAN(bool (*aceptar)(const twai_message_t &mensaje))
+{
+  filtroMensajes = aceptar;
+}
+
+void pausarReceptorCAN()
+{
+#ifndef RECEPCION_POR_SONDEO
+  if (tareaRecepcion == NULL)
+  {
+    return;
+  }
+  pausaSolicitada = true;
+  // Como mucho una espera de la tarea en el driver o en la cola llena
+  while (!tareaEnPausa.load())
+  {
+    vTaskDelay(1);
+  }
+  xQueueReset(colaRecepcion);
+#endif
+}
+
+void reanudarReceptorCAN()
+{
+#ifndef RECEPCION_POR_SONDEO
+  pausaSolicitada = false;
+#endif
+}
+
+void reiniciarEstadisticasReceptorCAN()
+{
+  memset(&estadisticasRecepcion, 0, sizeof(estadisticasRecepcion));
+}
+
+const EstadisticasReceptorCAN &obtenerEstadisticasReceptorCAN()
+{
+  return estadisticasRecepcion;
+}
+
+void mostrarEstadisticasReceptorCAN(const char *nombre)
+{
+  const EstadisticasReceptorCAN &e = estadisticasRecepcion;
+  double latenciaMedia = e.mensajes > 0 ? (double)e.sumatorioLatencia / e.mensajes : 0;
+#ifdef RECEPCION_POR_SONDEO
+  Serial.printf("Recepción %s (sondeo): %lu mensajes, CPU en espera activa %f ms, %lu sondeos vacíos, latencia de detección estimada %f us (máx %lu us)\n",
+                nombre, (unsigned long)e.mensajes, (double)e.tiempoEsperaActiva / 1000, (unsigned long)e.sondeos, latenciaMedia, e.latenciaMaxima);
+#else
+  Serial.printf("Recepción %s (tarea): %lu mensajes, CPU cedida %f ms, latencia de despertar media %f us (máx %lu us)\n",
+                nombre, (unsigned long)e.mensajes, (double)e.tiempoCedido / 1000, latenciaMedia, e.latenciaMaxima);
+#endif
+}
@@ -0,0 +1,122 @@
+#include "ReservaFlujoCTR.h"
+#include "AnilloSPSC.h"
+
+// Bloque de flujo de cifrado junto con el contador al que corresponde
+struct BloqueFlujoCTR
+{
+  uint64_t contador;
+  uint8_t flujo[LONGITUD_BLOQUE_CTR];
+};
+
+// Flujo registrado: la tarea de la reserva produce y el camino crítico consume
+struct FlujoCTR
+{
+  mbedtls_aes_context *cifrador;
+  uint32_t identificador;
+  uint8_t dominio;
+  uint64_t siguienteContador; // Siguiente contador a calcular, sólo lo usa la tarea de la reserva
+  AnilloSPSC<BloqueFlujoCTR, LONGITUD_RESERVA_CTR> anillo;
+};
+
+static FlujoCTR flujosCTR[MAX_FLUJOS_CTR];
+static uint8_t numeroFlujosCTR = 0;
+static TaskHandle_t tareaReserva = NULL;
+static EstadisticasReservaCTR estadisticasReserva;
+
+// Tarea que rellena los anillos, un bloque de cada flujo por vuelta
+static void hiloReserva(void *param)
+{
+  while (true)
+  {
+    bool todosLlenos = true;
+    for (uint8_t i = 0; i < numeroFlujosCTR; i++)
+    {
+      FlujoCTR &flujo = flujosCTR[i];
+      BloqueFlujoCTR *bloque = flujo.anillo.reservar();
+      if (bloque == NULL)
+      {
+        continue;
+      }
+      bloque->contador = flujo.siguienteContador;
+      generarFlujoCTR(flujo.cifrador, flujo.identificador, flujo.dominio, flujo.siguienteContador, bloque->flujo);
+      flujo.siguienteContador++;
+      flujo.anillo.publicar();
+      todosLlenos = false;
+    }
+    if (todosLlenos)
+    {
+      vTaskDelay(1); // Nada que calcular, cedemos el núcleo hasta el siguiente tick
+    }
+  }
+}
+
+int8_t registrarFlujoCTR(mbedtls_aes_context *cifrador, uint32_t identificador, uint8_t dominio, uint64_t contadorInicial)
+{
+  if (tareaReserva != NULL || numeroFlujosCTR >= MAX_FLUJOS_CTR || cifrador == NULL)
+  {
+    return -1;
+  }
+  FlujoCTR &flujo = flujosCTR[numeroFlujosCTR];
+  flujo.cifrador = cifrador;
+  flujo.identificador = identificador;
+  flujo.dominio = dominio;
+  flujo.siguienteContador = contadorInicial;
+  return numeroFlujosCTR++;
+}
+
+bool iniciarReservaCTR(BaseType_t nucleo)
+{
+  reiniciarEstadisticasReservaCTR();
+  if (tareaReserva != NULL || numeroFlujosCTR == 0)
+  {
+    return true; // Ya estaba iniciada o no hay nada que calcular
+  }
+  return xTaskCreatePinnedToCore(hiloReserva, "ReservaCTR", 4096, NULL, PRIORIDAD_TAREA_RESERVA, &tareaReserva, nucleo) == pdPASS;
+}
+
+void aplicarFlujoReservaCTR(int8_t flujo, uint64_t contador, const uint8_t *entrada, uint8_t *salida, uint8_t longitud)
+{
+  FlujoCTR &registrado = flujosCTR[flujo];
+  // Los bloques de contadores que ya han pasado no se van a usar
+  BloqueFlujoCTR *bloque;
+  while ((bloque = registrado.anillo.frente()) != NULL && bloque->contador < contador)
+  {
+    registrado.anillo.liberar();
+    estadisticasReserva.descartados++;
+  }
+  if (bloque != NULL && bloque->contador == contador)
+  {
+    // Acierto: XOR directamente desde el anillo y devolvemos el hueco
+    aplicarFlujoCTR(bloque->flujo, entrada, salida, longitud);
+    registrado.anillo.liberar();
+    estadisticasReserva.aciertos++;
+    return;
+  }
+  // Fallo: la reserva no ha llegado a este contador, lo calculamos en el momento
+  uint8_t calculado[LONGITUD_BLOQUE_CTR];
+  generarFlujoCTR(registrado.cifrador, registrado.identificador, registrado.dominio, contador, calculado);
+  aplicarFlujoCTR(calculado, entrada, salida, longitud);
+  estadisticasReserva.fallos++;
+}
+
+void reiniciarEstadisticasReservaCTR()
+{
+  memset(&estadisticasReserva, 0, sizeof(estadisticasReserva));
+}
+
+const EstadisticasReservaCTR &obtenerEstadisticasReservaCTR()
+{
+  return estadisticasReserva;
+}
+
+void mostrarEstadisticasReservaCTR(const char *nombre)
+{
+  uint32_t usos = estadisticasReserva.aciertos + estadisticasReserva.fallos;
+  if (usos == 0)
+  {
+    return;
+  }
+  Serial.printf("Reserva CTR %s: %lu aciertos y %lu fallos (%.1f %% de aciertos), %lu bloques descartados\n", nombre,
+                (unsigned long)estadisticasReserva.aciertos, (unsigned long)estadisticasReserva.fallos,
+                100.0 * estadisticasReserva.aciertos / usos, (unsigned long)estadisticasReserva.descartados);
+}
@@ -0,0 +1,278 @@
+#include "TopologiaCAN.h"
+
+#ifdef MODO_MULTINODO
+#include "ReceptorCAN.h"
+#include "TransporteCAN.h"
+#include <atomic>
+
+// Tipos de trama de control, en el primer byte
+const uint8_t CONTROL_FIN_ESQUEMA = 0xF1; // Emisor: ha terminado el esquema
+const uint8_t CONTROL_LIBERAR = 0xF2;     // Receptor: ha terminado el esquema y el emisor puede seguir
+// Nodo que no está en la tabla
+const uint8_t NINGUN_NODO = 0xFF;
+
+static NodoCAN nodosTopologia[MAX_NODOS_CAN];
+static uint8_t numeroNodosTopologia = 0;
+static uint8_t nodoLocal = 0;
+static bool extendidoTopologia = false;
+static uint8_t emisores = 0;
+static uint8_t receptores = 0;
+// Receptor que envía los controles de flujo de las PDUs por difusión
+static uint8_t receptorPrincipal = NINGUN_NODO;
+// Tramas de control recibidas y todavía no consumidas. Las cuenta la tarea receptora
+static std::atomic<uint32_t> finesRecibidos{0};
+static std::atomic<uint32_t> liberacionesRecibidas{0};
+
+// Nodo en cuyo bloque está el identificador, y su posición dentro del bloque
+static uint8_t nodoIdentificador(uint32_t identificador, uint8_t *destino)
+{
+  for (uint8_t i = 0; i < numeroNodosTopologia; i++)
+  {
+    if (identificador >= nodosTopologia[i].bloque && identificador - nodosTopologia[i].bloque < IDS_POR_NODO_CAN)
+    {
+      *destino = identificador - nodosTopologia[i].bloque;
+      return i;
+    }
+  }
+  return NINGUN_NODO;
+}
+
+// Filtro de la tarea receptora: deja pasar lo que va a este nodo y cuenta las tramas de control
+static bool aceptarMensajeTopologia(const twai_message_t &mensaje)
+{
+  uint8_t destino;
+  uint8_t origen = nodoIdentificador(mensaje.identifier, &destino);
+  if (origen == NINGUN_NODO || origen == nodoLocal)
+  {
+    return false;
+  }
+  if (destino == nodoLocal)
+  {
+    return true;
+  }
+  // La difusión y el control sólo interesan a los nodos del otro papel
+  if (nodosTopologia[origen].rol == nodosTopologia[nodoLocal].rol)
+  {
+    return false;
+  }
+  if (destino == DESTINO_DIFUSION_CAN)
+  {
+    return true;
+  }
+  if (destino == DESTINO_CONTROL_CAN && mensaje.data_length_code >= 1)
+  {
+    if (mensaje.data[0] == CONTROL_FIN_ESQUEMA)
+    {
+      finesRecibidos++;
+    }
+    else if (mensaje.data[0] == CONTROL_LIBERAR)
+    {
+      liberacionesRecibidas++;
+    }
+  }
+  return false;
+}
+
+// Controles de flujo del transporte: al emisor, salvo en la difusión, donde sólo los envía el receptor principal
+static uint32_t identificadorControlFlujo(uint32_t recibido)
+{
+  uint8_t destino;
+  uint8_t origen = nodoIdentificador(recibido, &destino);
+  if (origen == NINGUN_NODO || (destino == DESTINO_DIFUSION_CAN && nodoLocal != receptorPrincipal))
+  {
+    return SIN_CONTROL_FLUJO_CAN;
+  }
+  return nodosTopologia[nodoLocal].bloque + origen;
+}
+
+bool iniciarTopologiaCAN(const NodoCAN *nodos, uint8_t numeroNodos, uint8_t local, RolNodoCAN rolLocal, bool extendido)
+{
+  if (numeroNodos < 2 || numeroNodos > MAX_NODOS_CAN || local >= numeroNodos)
+  {
+    Serial.printf("Topología: hacen falta de 2 a %u nodos y el nodo local (%u) tiene que ser uno de los %u activos\n",
+                  (unsigned)MAX_NODOS_CAN, (unsigned)local, (unsigned)numeroNodos);
+    return false;
+  }
+  if (nodos[local].rol != rolLocal)
+  {
+    Serial.printf("Topología: el nodo %u es %s en la tabla pero este programa es %s\n", (unsigned)local,
+                  nodos[local].rol == NODO_EMISOR ? "emisor" : "receptor", rolLocal == NODO_EMISOR ? "emisor" : "receptor");
+    return false;
+  }
+  emisores = 0;
+  receptores = 0;
+  receptorPrincipal = NINGUN_NODO;
+  for (uint8_t i = 0; i < numeroNodos; i++)
+  {
+    for (uint8_t j = 0; j < i; j++)
+    {
+      uint32_t distancia = nodos[i].bloque > nodos[j].bloque ? nodos[i].bloque - nodos[j].bloque : nodos[j].bloque - nodos[i].bloque;
+      if (distancia < IDS_POR_NODO_CAN)
+      {
+        Serial.printf("Topología: los bloques de los nodos %u y %u se solapan\n", (unsigned)j, (unsigned)i);
+        return false;
+      }
+    }
+    if (nodos[i].rol == NODO_EMISOR)
+    {
+      emisores++;
+    }
+    else
+    {
+      if (receptorPrincipal == NINGUN_NODO)
+      {
+        receptorPrincipal = i;
+      }
+      receptores++;
+    }
+  }
+  // Uno a varios o varios a uno: con varios emisores y varios receptores la difusión tendría varios orígenes
+  if (emisores == 0 || receptores == 0 || (emisores > 1 && receptores > 1))
+  {
+    Serial.printf("Topología: %u emisores y %u receptores; tiene que haber un emisor o un receptor\n", (unsigned)emisores, (unsigned)receptores);
+    return false;
+  }
+  memcpy(nodosTopologia, nodos, numeroNodos * sizeof(NodoCAN));
+  numeroNodosTopologia = numeroNodos;
+  nodoLocal = local;
+  extendidoTopologia = extendido;
+  finesRecibidos = 0;
+  liberacionesRecibidas = 0;
+  filtrarMensajesCAN(aceptarMensajeTopologia);
+  dirigirControlFlujoTransporteCAN(identificadorControlFlujo);
+  Serial.printf("Topología: nodo %u de %u, %s, bloque 0x%03lX; %s con %u emisores y %u receptores\n", (unsigned)local, (unsigned)numeroNodos,
+                rolLocal == NODO_EMISOR ? "emisor" : "receptor", (unsigned long)nodos[local].bloque,
+                emisores == 1 ? "uno a varios" : "varios a uno", (unsigned)emisores, (unsigned)receptores);
+  return true;
+}
+
+uint8_t parametroTopologiaCAN(const char *variable, uint8_t porDefecto)
+{
+#ifdef ESP_PLATFORM
+  return porDefecto;
+#else
+  const char *valor = getenv(variable);
+  return valor != NULL && *valor != '\0' ? (uint8_t)atoi(valor) : porDefecto;
+#endif
+}
+
+void filtroTopologiaCAN(uint32_t *identificador, uint32_t *bitsFijos)
+{
+  // Los bits que valen lo mismo en todos los identificadores de todos los bloques
+  uint32_t unos = 0xFFFFFFFF;
+  uint32_t ceros = 0xFFFFFFFF;
+  for (uint8_t i = 0; i < numeroNodosTopologia; i++)
+  {
+    for (uint32_t j = 0; j < IDS_POR_NODO_CAN; j++)
+    {
+      unos &= nodosTopologia[i].bloque + j;
+      ceros &= ~(nodosTopologia[i].bloque + j);
+    }
+  }
+  *identificador = unos;
+  *bitsFijos = unos | ceros;
+}
+
+uint32_t identificadorDestinoCAN()
+{
+  const NodoCAN &local = nodosTopologia[nodoLocal];
+  // Con un solo nodo del otro papel se le envía directamente
+  if ((local.rol == NODO_EMISOR ? receptores : emisores) > 1)
+  {
+    return local.bloque + DESTINO_DIFUSION_CAN;
+  }
+  for (uint8_t i = 0; i < numeroNodosTopologia; i++)
+  {
+    if (nodosTopologia[i].rol != local.rol)
+    {
+      return local.bloque + i;
+    }
+  }
+  return local.bloque + DESTINO_DIFUSION_CAN;
+}
+
+uint32_t identificadorRespuestaCAN(uint32_t recibido)
+{
+  uint8_t destino;
+  uint8_t origen = nodoIdentificador(recibido, &destino);
+  return nodosTopologia[nodoLocal].bloque + (origen != NINGUN_NODO ? origen : DESTINO_DIFUSION_CAN);
+}
+
+uint8_t emisoresTopologiaCAN()
+{
+  return emisores;
+}
+
+uint8_t receptoresTopologiaCAN()
+{
+  return receptores;
+}
+
+uint8_t nodoLocalTopologiaCAN()
+{
+  return nodoLocal;
+}
+
+uint8_t nodoOrigenTopologiaCAN(uint32_t recibido)
+{
+  uint8_t destino;
+  uint8_t origen = nodoIdentificador(recibido, &destino);
+  // El filtro de la tarea receptora sólo deja pasar identificadores de la tabla
+  return origen != NINGUN_NODO ? origen : 0;
+}
+
+uint8_t primerEmisorTopologiaCAN()
+{
+  for (uint8_t i = 0; i < numeroNodosTopologia; i++)
+  {
+    if (nodosTopologia[i].rol == NODO_EMISOR)
+    {
+      return i;
+    }
+  }
+  return 0;
+}
+
+uint32_t bloqueNodoTopologiaCAN(uint8_t nodo)
+{
+  return nodosTopologia[nodo].bloque;
+}
+
+// Espera hasta que se hayan contado las tramas de control indicadas y las consume
+static void esperarControlTopologia(std::atomic<uint32_t> &contador, uint32_t esperadas)
+{
+  while (contador.load() < esperadas)
+  {
+    // En modo sondeo el filtro sólo se aplica al recibir, así que hay que seguir leyendo.
+    // Al final del esquema no llega nada más que el control
+    leerMensajeCAN(pdMS_TO_TICKS(10));
+  }
+  contador -= esperadas;
+}
+
+// Envía una trama de control a los nodos del otro papel
+static void enviarControlTopologia(uint8_t tipo)
+{
+  twai_message_t mensaje;
+  memset(&mensaje, 0, sizeof(mensaje));
+  mensaje.extd = extendidoTopologia;
+  mensaje.identifier = nodosTopologia[nodoLocal].bloque + DESTINO_CONTROL_CAN;
+  mensaje.data_length_code = 1;
+  mensaje.data[0] = tipo;
+  twai_transmit(&mensaje, pdMS_TO_TICKS(1000));
+}
+
+void terminarEsquemaTopologiaCAN()
+{
+  if (nodosTopologia[nodoLocal].rol == NODO_EMISOR)
+  {
+    enviarControlTopologia(CONTROL_FIN_ESQUEMA);
+    esperarControlTopologia(liberacionesRecibidas, receptores);
+  }
+  else
+  {
+    esperarControlTopologia(finesRecibidos, emisores);
+    enviarControlTopologia(CONTROL_LIBERAR);
+  }
+}
+#endif
@@ -0,0 +1,763 @@
+#include "TransporteCAN.h"
+#include "ReceptorCAN.h"
+#include "TrazaCiclos.h"
+#include "ContadorCopias.h"
+#include "MotorBenchmark.h"
+
+// Tipos de trama, en el nibble alto del primer byte
+const uint8_t TRAMA_UNICA = 0x00;
+const uint8_t PRIMERA_TRAMA = 0x10;
+const uint8_t TRAMA_CONSECUTIVA = 0x20;
+const uint8_t CONTROL_FLUJO = 0x30;
+// Estado del control de flujo, en el nibble bajo
+const uint8_t FLUJO_CONTINUAR = 0x00;
+const uint8_t FLUJO_ESPERAR = 0x01;
+const uint8_t FLUJO_DESBORDAMIENTO = 0x02;
+// Bytes útiles de cada tipo de trama
+const uint8_t DATOS_TRAMA_UNICA_CORTA = TWAI_FRAME_MAX_DLC - 1; // Con la longitud en el primer byte
+#ifdef CAN_FD
+const uint8_t DATOS_TRAMA_UNICA = LONGITUD_TRAMA_TRANSPORTE - 2; // Con la longitud en el segundo byte
+#else
+const uint8_t DATOS_TRAMA_UNICA = DATOS_TRAMA_UNICA_CORTA;
+#endif
+const uint8_t DATOS_PRIMERA_TRAMA = LONGITUD_TRAMA_TRANSPORTE - 2;
+const uint8_t DATOS_PRIMERA_TRAMA_LARGA = LONGITUD_TRAMA_TRANSPORTE - 6; // Con la longitud en 32 bits, para más de 4095 bytes
+const uint8_t DATOS_TRAMA_CONSECUTIVA = LONGITUD_TRAMA_TRANSPORTE - 1;
+const uint16_t LONGITUD_MAXIMA_CORTA = 0xFFF; // Lo que cabe en los 12 bits de longitud de la primera trama
+
+static twai_message_t mensajeTransmitido;
+// Último mensaje leído, en el hueco de la recepción donde lo dejó el driver o en mensajeRecuperado
+static const twai_message_t *mensajeLeido = NULL;
+static twai_message_t mensajeRecuperado;
+static uint32_t bitrateTransporte;
+static uint8_t bloqueLocal;     // Tamaño de bloque que pedimos al emisor
+static uint8_t separacionLocal; // Separación mínima que pedimos al emisor, codificada como STmin
+// Buffer de reensamblado, reservado de antemano, para quien no indica dónde quiere la PDU
+static uint8_t bufferRecepcion[LONGITUD_MAXIMA_TRANSPORTE];
+// Donde se reensambla la PDU en curso: cada trama se copia directamente en su posición
+static uint8_t *destinoRecepcion = bufferRecepcion;
+static uint16_t capacidadRecepcion = LONGITUD_MAXIMA_TRANSPORTE;
+static MedidaTransferencia ultimaTransferencia;
+static void (*desvioMensajes)(const twai_message_t &mensaje) = NULL;
+static uint32_t (*direccionControlFlujo)(uint32_t recibido) = NULL;
+// Tramas de otros emisores aplazadas durante una transferencia, con su instante de llegada
+struct MensajeAplazado
+{
+  twai_message_t mensaje;
+  uint64_t instanteLlegada;
+};
+// Caben las que pueden tener en vuelo todos los nodos de la tabla con la ventana de MODO_CAUDAL llena
+static const uint16_t MENSAJES_APLAZADOS_TRANSPORTE = MAX_NODOS_CAN * VENTANA_CAUDAL;
+static MensajeAplazado mensajesAplazados[MENSAJES_APLAZADOS_TRANSPORTE];
+static uint16_t primerAplazado = 0;
+static uint16_t numeroAplazados = 0;
+// Llegada del último mensaje leído
+static uint64_t instanteMensajeLeido = 0;
+static EstadisticasTransporteCAN estadisticasTransporte;
+// Inicio de la última ráfaga encolada de la transferencia enviada, hasta que se espera su fin
+static uint64_t inicioRafaga = 0;
+static bool rafagaPendiente = false;
+static HistogramaLatencia retrasoTransporte;
+static HistogramaLatencia huecoTramas;
+
+uint32_t bitrateCAN(const twai_timing_config_t &tiempos)
+{
+  // El TWAI del ESP32 cuenta con el reloj APB de 80 MHz
+  return 80000000UL / (tiempos.brp * (1 + tiempos.tseg_1 + tiempos.tseg_2));
+}
+
+unsigned long tiempoBusMensajeCAN(const twai_message_t &mensaje)
+{
+#ifdef CAN_FD
+  if (mensaje.fd)
+  {
+    // Al bitrate nominal: arbitraje hasta el bit BRS, ACK, EOF y espacio entre tramas
+    uint32_t bitsNominales = (mensaje.extd ? 36 : 17) + 12;
+    // Fase de datos: ESI, DLC, datos, contador de relleno y CRC con su delimitador
+    uint32_t bitsDatos = 1 + 4 + 8 * mensaje.data_length_code + 4 + (mensaje.data_length_code <= 16 ? 17 : 21) + 1;
+    if (!mensaje.brs)
+    {
+      return (unsigned long)((uint64_t)(bitsNominales + bitsDatos) * 1000000 / bitrateTransporte);
+    }
+    return (unsigned long)((uint64_t)bitsNominales * 1000000 / bitrateTransporte + (uint64_t)bitsDatos * 1000000 / BITRATE_DATOS_FD);
+  }
+#endif
+  // SOF, identificador, control, CRC, ACK, EOF y espacio entre tramas, más los datos
+  uint32_t bits = (mensaje.extd ? 67 : 47) + 8 * mensaje.data_length_code;
+  return (unsigned long)((uint64_t)bits * 1000000 / bitrateTransporte);
+}
+
+#ifdef CAN_FD
+// Byte de relleno de las tramas FD, el que recomienda ISO 15765-2
+const uint8_t RELLENO_TRAMA_FD = 0xCC;
+
+// Longitud válida de FD inmediatamente superior: de 0 a 8 y después 12, 16, 20, 24, 32, 48 y 64
+static uint8_t longitudTramaFD(uint8_t longitud)
+{
+  static const uint8_t LONGITUDES_FD[] = {12, 16, 20, 24, 32, 48, 64};
+  if (longitud <= TWAI_FRAME_MAX_DLC)
+  {
+    return longitud;
+  }
+  for (uint8_t i = 0; i < sizeof(LONGITUDES_FD); i++)
+  {
+    if (longitud <= LONGITUDES_FD[i])
+    {
+      return LONGITUDES_FD[i];
+    }
+  }
+  return TWAI_FD_FRAME_MAX_LEN;
+}
+#endif
+
+void iniciarTransporteCAN(uint32_t identificador, bool extendido, const twai_timing_config_t &tiempos, uint8_t tamanoBloque, uint8_t separacionMinima)
+{
+  memset(&mensajeTransmitido, 0, sizeof(mensajeTransmitido));
+  mensajeTransmitido.extd = extendido;
+  mensajeTransmitido.identifier = identificador;
+#ifdef CAN_FD
+  mensajeTransmitido.fd = 1;
+  mensajeTransmitido.brs = CONMUTACION_BITRATE_FD;
+#endif
+  bitrateTransporte = bitrateCAN(tiempos);
+  bloqueLocal = tamanoBloque;
+  separacionLocal = separacionMinima;
+  reiniciarEstadisticasTransporteCAN();
+}
+
+// Pasa la separación mínima codificada como STmin a us
+static unsigned long decodificarSeparacion(uint8_t separacion)
+{
+  if (separacion <= 0x7F)
+  {
+    return separacion * 1000UL; // De 0 a 127 ms
+  }
+  if (separacion >= 0xF1 && separacion <= 0xF9)
+  {
+    return (separacion - 0xF0) * 100UL; // De 100 a 900 us
+  }
+  return 127000UL; // Valor reservado: se usa el máximo, como indica la norma
+}
+
+// Suma un mensaje enviado o recibido y su tiempo en el bus a la transferencia en curso
+static void contarMensaje(const twai_message_t &mensaje, bool control)
+{
+  if (control)
+  {
+    ultimaTransferencia.tramasControl++;
+  }
+  else
+  {
+    ultimaTransferencia.tramas++;
+  }
+  ultimaTransferencia.tiempoBus += tiempoBusMensajeCAN(mensaje);
+}
+
+// Transmite el mensaje preparado con la longitud indicada
+static bool transmitir(uint8_t longitud, bool control)
+{
+#ifdef CAN_FD
+  // Se rellena hasta la siguiente longitud que admite FD
+  uint8_t longitudTrama = longitudTramaFD(longitud);
+  memset(mensajeTransmitido.data + longitud, RELLENO_TRAMA_FD, longitudTrama - longitud);
+  longitud = longitudTrama;
+#endif
+  mensajeTransmitido.data_length_code = longitud;
+#ifdef ENVIO_TRAMA_A_TRAMA
+  if (twai_transmit(&mensajeTransmitido, ESPERA_MAXIMA_TRANSPORTE) != ESP_OK)
+  {
+    return false;
+  }
+#else
+  // La cola de transmisión cabe toda la PDU, así que se encola sin esperar; sólo si otro la ha llenado se espera hueco
+  if (twai_transmit(&mensajeTransmitido, 0) != ESP_OK)
+  {
+    estadisticasTransporte.colaLlena++;
+    if (twai_transmit(&mensajeTransmitido, ESPERA_MAXIMA_TRANSPORTE) != ESP_OK)
+    {
+      return false;
+    }
+  }
+#endif
+  sondaTraza(FASE_ENCOLADO);
+  contarMensaje(mensajeTransmitido, control);
+  return true;
+}
+
+// Deja en mensajeLeido el siguiente mensaje, primero los aplazados salvo que no se quieran
+// (las tramas consecutivas de la transferencia en curso sólo pueden venir de la cola)
+static bool leerMensaje(TickType_t espera, bool aplazados = true)
+{
+  if (aplazados && numeroAplazados > 0)
+  {
+    // El hueco del aplazado se puede volver a usar en esta transferencia, así que se saca de él
+    mensajeRecuperado = mensajesAplazados[primerAplazado].mensaje;
+    contarCopia(COPIA_RECEPCION, sizeof(mensajeRecuperado));
+    mensajeLeido = &mensajeRecuperado;
+    instanteMensajeLeido = mensajesAplazados[primerAplazado].instanteLlegada;
+    primerAplazado = (primerAplazado + 1) % MENSAJES_APLAZADOS_TRANSPORTE;
+    numeroAplazados--;
+    return true;
+  }
+  mensajeLeido = leerMensajeCAN(espera);
+  if (mensajeLeido == NULL)
+  {
+    return false;
+  }
+  instanteMensajeLeido = instanteLlegadaCAN();
+  return true;
+}
+
+#ifndef TRAMADO_DIRECTO
+// Guarda mensajeLeido para después de la transferencia en curso. Si no cabe se pierde y se cuenta como descartado
+static void aplazarMensaje()
+{
+  if (numeroAplazados >= MENSAJES_APLAZADOS_TRANSPORTE)
+  {
+    estadisticasTransporte.descartadas++;
+    return;
+  }
+  estadisticasTransporte.aplazadas++;
+  MensajeAplazado &aplazado = mensajesAplazados[(primerAplazado + numeroAplazados) % MENSAJES_APLAZADOS_TRANSPORTE];
+  aplazado.mensaje = *mensajeLeido;
+  contarCopia(COPIA_RECEPCION, sizeof(aplazado.mensaje));
+  aplazado.instanteLlegada = instanteMensajeLeido;
+  numeroAplazados++;
+}
+#endif
+
+// Suma el tiempo encolando tramas consecutivas seguidas desde el instante indicado
+static void contarEncolado(uint64_t tiempoInicial, uint16_t tramas)
+{
+  ultimaTransferencia.tiempoEncolado += micros64() - tiempoInicial;
+  estadisticasTransporte.tramasEncoladas += tramas;
+  inicioRafaga = tiempoInicial;
+}
+
+// Anota el tiempo desde el inicio de la última ráfaga enviada hasta ahora, que ya se ha transmitido
+static void anotarFinTransmision()
+{
+  if (!rafagaPendiente)
+  {
+    return;
+  }
+  rafagaPendiente = false;
+  ultimaTransferencia.tiempoFinTransmision = micros64() - inicioRafaga;
+  estadisticasTransporte.finesTransmision++;
+  estadisticasTransporte.sumatorioTiempoFinTransmision += ultimaTransferencia.tiempoFinTransmision;
+}
+
+// Anota el hueco en el bus entre una trama y la anterior, recibidas seguidas
+static void anotarHueco(uint64_t llegadaAnterior)
+{
+  unsigned long separacion = instanteMensajeLeido - llegadaAnterior;
+  unsigned long tiempoBus = tiempoBusMensajeCAN(*mensajeLeido);
+  huecoTramas.anotar(separacion > tiempoBus ? separacion - tiempoBus : 0);
+}
+
+static void empezarTransferencia(uint16_t longitud)
+{
+  memset(&ultimaTransferencia, 0, sizeof(ultimaTransferencia));
+  ultimaTransferencia.longitud = longitud;
+  rafagaPendiente = false;
+}
+
+static void terminarTransferencia(uint64_t tiempoInicial, bool correcta)
+{
+  ultimaTransferencia.tiempoTransferencia = micros64() - tiempoInicial;
+  estadisticasTransporte.transferencias++;
+  if (!correcta)
+  {
+    estadisticasTransporte.errores++;
+  }
+  estadisticasTransporte.tramas += ultimaTransferencia.tramas;
+  estadisticasTransporte.tramasControl += ultimaTransferencia.tramasControl;
+  estadisticasTransporte.sumatorioTiempoTransferencia += ultimaTransferencia.tiempoTransferencia;
+  estadisticasTransporte.sumatorioTiempoBus += ultimaTransferencia.tiempoBus;
+  estadisticasTransporte.sumatorioTiempoEncolado += ultimaTransferencia.tiempoEncolado;
+  // Con una sola trama el retraso es sobre todo el de encolar y recibir; con varias se suma
+  // el de cada trama que pierde el arbitraje frente al tráfico de otros nodos
+  if (correcta && ultimaTransferencia.tramas > 1)
+  {
+    unsigned long tiempoBus = ultimaTransferencia.tiempoBus;
+    retrasoTransporte.anotar(ultimaTransferencia.tiempoTransferencia > tiempoBus ? ultimaTransferencia.tiempoTransferencia - tiempoBus : 0);
+  }
+}
+
+#ifndef TRAMADO_DIRECTO
+// Espera el control de flujo del receptor. Devuelve false si no llega, si se desborda o si hay demasiadas esperas
+static bool esperarControlFlujo(uint8_t *bloque, unsigned long *separacion)
+{
+  uint8_t esperas = 0;
+  while ((mensajeLeido = leerMensajeCAN(ESPERA_MAXIMA_TRANSPORTE)) != NULL)
+  {
+    if ((mensajeLeido->data[0] & 0xF0) != CONTROL_FLUJO || mensajeLeido->data_length_code < 3)
+    {
+      // No es un control de flujo: se pasa a quien lo quiera o se ignora
+      if (desvioMensajes != NULL)
+      {
+        desvioMensajes(*mensajeLeido);
+      }
+      continue;
+    }
+    contarMensaje(*mensajeLeido, true);
+    uint8_t estado = mensajeLeido->data[0] & 0x0F;
+    if (estado == FLUJO_CONTINUAR)
+    {
+      sondaTraza(FASE_CONTROL_FLUJO);
+      *bloque = mensajeLeido->data[1];
+      *separacion = decodificarSeparacion(mensajeLeido->data[2]);
+      return true;
+    }
+    if (estado != FLUJO_ESPERAR || ++esperas > MAX_ESPERAS_TRANSPORTE)
+    {
+      return false; // Desbordamiento, estado desconocido o el receptor no se libera
+    }
+  }
+  return false;
+}
+
+// Envía las tramas ISO-TP de la PDU
+static bool enviarTramas(const uint8_t *datos, uint16_t longitud)
+{
+  if (longitud <= DATOS_TRAMA_UNICA_CORTA)
+  {
+    mensajeTransmitido.data[0] = TRAMA_UNICA | longitud;
+    memcpy(mensajeTransmitido.data + 1, datos, longitud);
+    contarCopia(COPIA_ENVIO, longitud);
+    return transmitir(1 + longitud, false);
+  }
+#ifdef CAN_FD
+  if (longitud <= DATOS_TRAMA_UNICA)
+  {
+    // Trama única FD: el primer byte a cero y la longitud en el segundo
+    mensajeTransmitido.data[0] = TRAMA_UNICA;
+    mensajeTransmitido.data[1] = longitud;
+    memcpy(mensajeTransmitido.data + 2, datos, longitud);
+    contarCopia(COPIA_ENVIO, longitud);
+    return transmitir(2 + longitud, false);
+  }
+#endif
+
+  // Primera trama con la longitud total
+  uint16_t enviados;
+  if (longitud <= LONGITUD_MAXIMA_CORTA)
+  {
+    mensajeTransmitido.data[0] = PRIMERA_TRAMA | (longitud >> 8);
+    mensajeTransmitido.data[1] = longitud & 0xFF;
+    memcpy(mensajeTransmitido.data + 2, datos, DATOS_PRIMERA_TRAMA);
+    contarCopia(COPIA_ENVIO, DATOS_PRIMERA_TRAMA);
+    enviados = DATOS_PRIMERA_TRAMA;
+  }
+  else
+  {
+    mensajeTransmitido.data[0] = PRIMERA_TRAMA;
+    mensajeTransmitido.data[1] = 0;
+    mensajeTransmitido.data[2] = 0;
+    mensajeTransmitido.data[3] = 0;
+    mensajeTransmitido.data[4] = longitud >> 8;
+    mensajeTransmitido.data[5] = longitud & 0xFF;
+    memcpy(mensajeTransmitido.data + 6, datos, DATOS_PRIMERA_TRAMA_LARGA);
+    contarCopia(COPIA_ENVIO, DATOS_PRIMERA_TRAMA_LARGA);
+    enviados = DATOS_PRIMERA_TRAMA_LARGA;
+  }
+  if (!transmitir(LONGITUD_TRAMA_TRANSPORTE, false))
+  {
+    return false;
+  }
+
+  // Tramas consecutivas, por bloques según el control de flujo del receptor
+  uint8_t secuencia = 1;
+  while (enviados < longitud)
+  {
+    uint8_t bloque;
+    unsigned long separacion;
+    if (!esperarControlFlujo(&bloque, &separacion))
+    {
+      return false;
+    }
+    unsigned long instanteAnterior = 0;
+    uint64_t inicioBloque = micros64();
+    uint16_t enBloque;
+    for (enBloque = 0; enviados < longitud && (bloque == 0 || enBloque < bloque); enBloque++)
+    {
+      // Espera activa para respetar la separación: es del orden de cientos de us y tiene que ser precisa
+      while (enBloque > 0 && micros() - instanteAnterior < separacion)
+      {
+      }
+      uint8_t bytes = longitud - enviados < DATOS_TRAMA_CONSECUTIVA ? longitud - enviados : DATOS_TRAMA_CONSECUTIVA;
+      mensajeTransmitido.data[0] = TRAMA_CONSECUTIVA | (secuencia & 0x0F);
+      memcpy(mensajeTransmitido.data + 1, datos + enviados, bytes);
+      contarCopia(COPIA_ENVIO, bytes);
+      instanteAnterior = micros();
+      if (!transmitir(1 + bytes, false))
+      {
+        return false;
+      }
+      enviados += bytes;
+      secuencia++;
+    }
+    contarEncolado(inicioBloque, enBloque);
+  }
+  return true;
+}
+
+// Envía un control de flujo al emisor
+static bool enviarControlFlujo(uint8_t estado)
+{
+  if (direccionControlFlujo != NULL)
+  {
+    uint32_t identificador = direccionControlFlujo(ultimaTransferencia.identificador);
+    if (identificador == SIN_CONTROL_FLUJO_CAN)
+    {
+      return true; // Otro receptor controla el flujo de esta transferencia
+    }
+    mensajeTransmitido.identifier = identificador;
+  }
+  mensajeTransmitido.data[0] = CONTROL_FLUJO | estado;
+  mensajeTransmitido.data[1] = bloqueLocal;
+  mensajeTransmitido.data[2] = separacionLocal;
+  return transmitir(3, true);
+}
+
+// Recibe las tramas ISO-TP de una PDU en el buffer de reensamblado
+static bool recibirTramas(uint16_t *longitud, uint64_t *tiempoInicial)
+{
+  // Esperamos sin límite el comienzo de la transferencia, el emisor puede estar calculando
+  uint32_t total = 0;
+  uint16_t recibidos = 0;
+  while (true)
+  {
+    if (!leerMensaje(portMAX_DELAY))
+    {
+      return false;
+    }
+    *tiempoInicial = micros64();
+    sondaTraza(FASE_PRIMERA_RX);
+    ultimaTransferencia.identificador = mensajeLeido->identifier;
+    uint8_t tipo = mensajeLeido->data[0] & 0xF0;
+    if (tipo == TRAMA_UNICA)
+    {
+      uint8_t cabecera = 1;
+      total = mensajeLeido->data[0] & 0x0F;
+      if (total == 0 && mensajeLeido->data_length_code > TWAI_FRAME_MAX_DLC)
+      {
+        // Trama única FD, con la longitud en el segundo byte
+        cabecera = 2;
+        total = mensajeLeido->data[1];
+      }
+      if (total == 0 || total + cabecera > mensajeLeido->data_length_code)
+      {
+        continue; // Trama única mal formada, se ignora
+      }
+      contarMensaje(*mensajeLeido, false);
+      if (total > capacidadRecepcion)
+      {
+        return false; // No cabe donde se ha pedido
+      }
+      memcpy(destinoRecepcion, mensajeLeido->data + cabecera, total);
+      contarCopia(COPIA_RECEPCION, total);
+      *longitud = total;
+      return true;
+    }
+    if (tipo == PRIMERA_TRAMA && mensajeLeido->data_length_code == LONGITUD_TRAMA_TRANSPORTE)
+    {
+      contarMensaje(*mensajeLeido, false);
+      total = ((mensajeLeido->data[0] & 0x0F) << 8) | mensajeLeido->data[1];
+      if (total != 0)
+      {
+        recibidos = DATOS_PRIMERA_TRAMA;
+      }
+      else
+      {
+        // Longitud de más de 4095 bytes en los 4 bytes siguientes
+        total = ((uint32_t)mensajeLeido->data[2] << 24) | ((uint32_t)mensajeLeido->data[3] << 16) | ((uint32_t)mensajeLeido->data[4] << 8) | mensajeLeido->data[5];
+        recibidos = DATOS_PRIMERA_TRAMA_LARGA;
+      }
+      break;
+    }
+    // Tramas consecutivas o controles de flujo sueltos, se ignoran
+  }
+  // La PDU no cabe donde se ha pedido, o la primera trama lleva más datos que toda la PDU
+  if (total > capacidadRecepcion || recibidos > total)
+  {
+    enviarControlFlujo(FLUJO_DESBORDAMIENTO);
+    return false;
+  }
+  // Los datos de la primera trama van al final de la trama, detrás de la cabecera
+  memcpy(destinoRecepcion, mensajeLeido->data + LONGITUD_TRAMA_TRANSPORTE - recibidos, recibidos);
+  contarCopia(COPIA_RECEPCION, recibidos);
+  *longitud = total;
+
+  // Tramas consecutivas, pidiendo un control de flujo al principio de cada bloque
+  uint8_t secuencia = 1;
+  uint16_t enBloque = 0;
+  uint64_t llegadaAnterior = 0;
+  while (recibidos < total)
+  {
+    if (enBloque == 0 && !enviarControlFlujo(FLUJO_CONTINUAR))
+    {
+      return false;
+    }
+    // Las primeras tramas de otros emisores se dejan para después; esperan nuestro control de flujo
+    do
+    {
+      if (!leerMensaje(ESPERA_MAXIMA_TRANSPORTE, false))
+      {
+        return false; // El emisor ha dejado de enviar
+      }
+      if (mensajeLeido->identifier != ultimaTransferencia.identificador)
+      {
+        aplazarMensaje();
+      }
+    } while (mensajeLeido->identifier != ultimaTransferencia.identificador);
+    sondaTraza(FASE_RESTO_RX);
+    contarMensaje(*mensajeLeido, false);
+    // La primera de cada bloque va detrás de nuestro control de flujo, no de la trama anterior
+    if (enBloque > 0)
+    {
+      anotarHueco(llegadaAnterior);
+    }
+    llegadaAnterior = instanteMensajeLeido;
+    if ((mensajeLeido->data[0] & 0xF0) != TRAMA_CONSECUTIVA || (mensajeLeido->data[0] & 0x0F) != (secuencia & 0x0F))
+    {
+      return false; // Trama inesperada o perdida
+    }
+    uint8_t bytes = total - recibidos < DATOS_TRAMA_CONSECUTIVA ? total - recibidos : DATOS_TRAMA_CONSECUTIVA;
+    if (mensajeLeido->data_length_code < 1 + bytes)
+    {
+      return false;
+    }
+    memcpy(destinoRecepcion + recibidos, mensajeLeido->data + 1, bytes);
+    contarCopia(COPIA_RECEPCION, bytes);
+    recibidos += bytes;
+    secuencia++;
+    enBloque++;
+    if (bloqueLocal != 0 && enBloque == bloqueLocal)
+    {
+      enBloque = 0;
+    }
+  }
+  return true;
+}
+#else
+// Trocea la PDU en mensajes completos sin cabeceras; el último sólo lleva los bytes que quedan
+static bool enviarTramas(const uint8_t *datos, uint16_t longitud)
+{
+  uint64_t inicioEncolado = micros64();
+  uint16_t tramas = 0;
+  for (uint16_t enviados = 0; enviados < longitud; enviados += LONGITUD_TRAMA_TRANSPORTE)
+  {
+    uint8_t bytes = longitud - enviados < LONGITUD_TRAMA_TRANSPORTE ? longitud - enviados : LONGITUD_TRAMA_TRANSPORTE;
+    memcpy(mensajeTransmitido.data, datos + enviados, bytes);
+    contarCopia(COPIA_ENVIO, bytes);
+    if (!transmitir(bytes, false))
+    {
+      return false;
+    }
+    tramas++;
+  }
+  // Sin cabeceras todas las tramas van seguidas, así que cuentan como consecutivas
+  contarEncolado(inicioEncolado, tramas);
+  return true;
+}
+
+// Recibe en orden los mensajes necesarios para la longitud esperada
+static bool recibirTramas(uint16_t longitudEsperada, uint16_t *longitud, uint64_t *tiempoInicial)
+{
+  uint64_t llegadaAnterior = 0;
+  for (uint16_t recibidos = 0; recibidos < longitudEsperada; recibidos += LONGITUD_TRAMA_TRANSPORTE)
+  {
+    if (!leerMensaje(portMAX_DELAY))
+    {
+      return false;
+    }
+    sondaTraza(recibidos == 0 ? FASE_PRIMERA_RX : FASE_RESTO_RX);
+    ultimaTransferencia.identificador = mensajeLeido->identifier;
+    contarMensaje(*mensajeLeido, false);
+    if (recibidos == 0)
+    {
+      *tiempoInicial = micros64();
+    }
+    else
+    {
+      anotarHueco(llegadaAnterior);
+    }
+    llegadaAnterior = instanteMensajeLeido;
+    uint8_t bytes = longitudEsperada - recibidos < LONGITUD_TRAMA_TRANSPORTE ? longitudEsperada - recibidos : LONGITUD_TRAMA_TRANSPORTE;
+    memcpy(destinoRecepcion + recibidos, mensajeLeido->data, bytes);
+    contarCopia(COPIA_RECEPCION, bytes);
+  }
+  *longitud = longitudEsperada;
+  return true;
+}
+#endif
+
+uint16_t tramasTransporteCAN(uint16_t longitud)
+{
+#ifdef TRAMADO_DIRECTO
+  return (longitud + LONGITUD_TRAMA_TRANSPORTE - 1) / LONGITUD_TRAMA_TRANSPORTE;
+#else
+  if (longitud <= DATOS_TRAMA_UNICA)
+  {
+    return 1;
+  }
+  uint16_t primera = longitud <= LONGITUD_MAXIMA_CORTA ? DATOS_PRIMERA_TRAMA : DATOS_PRIMERA_TRAMA_LARGA;
+  return 1 + (longitud - primera + DATOS_TRAMA_CONSECUTIVA - 1) / DATOS_TRAMA_CONSECUTIVA;
+#endif
+}
+
+bool enviarTransporteCAN(const uint8_t *datos, uint16_t longitud)
+{
+  empezarTransferencia(longitud);
+  uint64_t tiempoInicial = micros64();
+  inicioRafaga = tiempoInicial;
+  bool correcta = longitud <= LONGITUD_MAXIMA_TRANSPORTE && enviarTramas(datos, longitud);
+  terminarTransferencia(tiempoInicial, correcta);
+  rafagaPendiente = correcta;
+  return correcta;
+}
+
+const uint8_t *recibirTransporteCAN(uint16_t longitudEsperada, uint16_t *longitud, uint8_t *destino, uint16_t capacidad)
+{
+  empezarTransferencia(0);
+  destinoRecepcion = destino != NULL ? destino : bufferRecepcion;
+  capacidadRecepcion = destino != NULL ? capacidad : LONGITUD_MAXIMA_TRANSPORTE;
+  uint64_t tiempoInicial = micros64();
+#ifdef TRAMADO_DIRECTO
+  bool correcta = longitudEsperada <= capacidadRecepcion && recibirTramas(longitudEsperada, longitud, &tiempoInicial);
+#else
+  bool correcta = recibirTramas(longitud, &tiempoInicial);
+#endif
+  ultimaTransferencia.longitud = correcta ? *longitud : 0;
+  ultimaTransferencia.instanteLlegada = instanteMensajeLeido;
+  terminarTransferencia(tiempoInicial, correcta);
+  return correcta ? destinoRecepcion : NULL;
+}
+
+bool enviarTramaCAN(const uint8_t *datos, uint8_t longitud)
+{
+  empezarTransferencia(longitud);
+  uint64_t tiempoInicial = micros64();
+  inicioRafaga = tiempoInicial;
+  bool correcta = longitud <= LONGITUD_TRAMA_TRANSPORTE;
+  if (correcta)
+  {
+    memcpy(mensajeTransmitido.data, datos, longitud);
+    contarCopia(COPIA_ENVIO, longitud);
+    correcta = transmitir(longitud, false);
+  }
+  terminarTransferencia(tiempoInicial, correcta);
+  rafagaPendiente = correcta;
+  return correcta;
+}
+
+const uint8_t *recibirTramaCAN(uint8_t *longitud)
+{
+  empezarTransferencia(0);
+  bool correcta = leerMensaje(portMAX_DELAY);
+  uint64_t tiempoInicial = micros64();
+  sondaTraza(FASE_PRIMERA_RX);
+  if (correcta)
+  {
+    contarMensaje(*mensajeLeido, false);
+    ultimaTransferencia.identificador = mensajeLeido->identifier;
+    ultimaTransferencia.instanteLlegada = instanteMensajeLeido;
+    *longitud = mensajeLeido->data_length_code;
+    ultimaTransferencia.longitud = *longitud;
+  }
+  terminarTransferencia(tiempoInicial, correcta);
+  return correcta ? mensajeLeido->data : NULL;
+}
+
+void desviarMensajesTransporteCAN(void (*desvio)(const twai_message_t &mensaje))
+{
+  desvioMensajes = desvio;
+}
+
+void dirigirControlFlujoTransporteCAN(uint32_t (*identificador)(uint32_t recibido))
+{
+  direccionControlFlujo = identificador;
+}
+
+void esperarFinTransmisionCAN()
+{
+  twai_status_info_t estado;
+#ifdef ENVIO_TRAMA_A_TRAMA
+  while (twai_get_status_info(&estado) == ESP_OK && estado.msgs_to_tx > 0)
+  {
+  }
+#else
+  // Bloqueados hasta la alerta de cola vacía, una sola para toda la ráfaga. Una alerta que
+  // quedara de una transmisión anterior sólo hace dar una vuelta más
+  uint32_t alertas;
+  while (twai_get_status_info(&estado) == ESP_OK && estado.msgs_to_tx > 0)
+  {
+    if (twai_read_alerts(&alertas, ESPERA_MAXIMA_TRANSPORTE) != ESP_OK)
+    {
+      return; // Sin alertas configuradas o con el bus caído, no se espera más
+    }
+  }
+#endif
+  anotarFinTransmision();
+}
+
+const MedidaTransferencia &obtenerUltimaTransferencia()
+{
+  return ultimaTransferencia;
+}
+
+void reiniciarEstadisticasTransporteCAN()
+{
+  memset(&estadisticasTransporte, 0, sizeof(estadisticasTransporte));
+  retrasoTransporte.reiniciar();
+  huecoTramas.reiniciar();
+}
+
+const EstadisticasTransporteCAN &obtenerEstadisticasTransporteCAN()
+{
+  return estadisticasTransporte;
+}
+
+const HistogramaLatencia &obtenerRetrasoTransporteCAN()
+{
+  return retrasoTransporte;
+}
+
+const HistogramaLatencia &obtenerHuecoTramasCAN()
+{
+  return huecoTramas;
+}
+
+void mostrarEstadisticasTransporteCAN(const char *nombre)
+{
+  if (estadisticasTransporte.transferencias == 0)
+  {
+    return;
+  }
+  double transferencias = estadisticasTransporte.transferencias;
+  Serial.printf("Transporte %s: %.2f tramas y %.2f controles de flujo por transferencia, %lu errores\n", nombre,
+                estadisticasTransporte.tramas / transferencias, estadisticasTransporte.tramasControl / transferencias,
+                (unsigned long)estadisticasTransporte.errores);
+  if (estadisticasTransporte.aplazadas > 0 || estadisticasTransporte.descartadas > 0)
+  {
+    Serial.printf("Transporte %s: %lu tramas de otros emisores aplazadas y %lu descartadas porque no cabían\n", nombre,
+                  (unsigned long)estadisticasTransporte.aplazadas, (unsigned long)estadisticasTransporte.descartadas);
+  }
+  Serial.printf("Transporte %s: %f ms por transferencia, de ellos %f ms como mínimo en el bus\n", nombre,
+                estadisticasTransporte.sumatorioTiempoTransferencia / transferencias / 1000,
+                estadisticasTransporte.sumatorioTiempoBus / transferencias / 1000);
+  if (estadisticasTransporte.tramasEncoladas > 0)
+  {
+    Serial.printf("Transporte %s: %.2f us encolando cada trama consecutiva, %lu veces con la cola de transmisión llena\n", nombre,
+                  (double)estadisticasTransporte.sumatorioTiempoEncolado / estadisticasTransporte.tramasEncoladas,
+                  (unsigned long)estadisticasTransporte.colaLlena);
+  }
+  if (estadisticasTransporte.finesTransmision > 0)
+  {
+    Serial.printf("Transporte %s: %.2f us desde que se empieza a encolar la última ráfaga hasta que se ha transmitido\n", nombre,
+                  (double)estadisticasTransporte.sumatorioTiempoFinTransmision / estadisticasTransporte.finesTransmision);
+  }
+  retrasoTransporte.mostrar(nombre, "Retraso del transporte");
+  huecoTramas.mostrar(nombre, "Hueco entre tramas");
+}
@@ -0,0 +1,115 @@
+#include "TrazaCiclos.h"
+
+#ifdef TRAZA_CICLOS
+#include <atomic>
+
+// Número de sondas seguidas para medir el coste de una
+const uint32_t SONDAS_CALIBRACION = 1000;
+
+static const char *const NOMBRES_FASES[NUM_FASES_TRAZA] = {
+    "Carga", "Clave", "Criptografía", "Encolado", "Control de flujo", "Fin de TX", "Primera RX", "Resto de RX", "Verificación"};
+
+static EstadoTraza estadosTraza[MAX_HILOS_TRAZA];
+static std::atomic<uint8_t> hilosTraza{0};
+// Coste medido de una sonda, que se descuenta en el reparto
+static uint32_t ciclosSonda = 0;
+
+EstadoTraza *registrarHiloTraza()
+{
+  uint8_t hilo = hilosTraza.fetch_add(1);
+  // Si hay más hilos de los previstos comparten el último estado
+  EstadoTraza *estado = &estadosTraza[hilo < MAX_HILOS_TRAZA ? hilo : MAX_HILOS_TRAZA - 1];
+  estado->ultimaSonda = leerCiclos();
+  return estado;
+}
+
+// Ciclos del contador por us
+static double ciclosPorMicrosegundo()
+{
+#ifdef ESP_PLATFORM
+  return getCpuFrequencyMhz();
+#else
+  return 1000.0; // clock_gettime cuenta en ns
+#endif
+}
+
+void calibrarTraza()
+{
+  empezarTraza();
+  CiclosTraza inicial = leerCiclos();
+  for (uint32_t i = 0; i < SONDAS_CALIBRACION; i++)
+  {
+    sondaTraza(FASE_CARGA);
+  }
+  CiclosTraza final = leerCiclos();
+  ciclosSonda = (CiclosTraza)(final - inicial) / SONDAS_CALIBRACION;
+  reiniciarTraza();
+  Serial.printf("Traza por fases: %lu ciclos por sonda (%.3f us)\n", (unsigned long)ciclosSonda, ciclosSonda / ciclosPorMicrosegundo());
+}
+
+void reiniciarTraza()
+{
+  uint8_t hilos = hilosTraza.load() < MAX_HILOS_TRAZA ? hilosTraza.load() : MAX_HILOS_TRAZA;
+  for (uint8_t i = 0; i < hilos; i++)
+  {
+    memset(estadosTraza[i].ciclos, 0, sizeof(estadosTraza[i].ciclos));
+    memset(estadosTraza[i].sondas, 0, sizeof(estadosTraza[i].sondas));
+  }
+}
+
+// Ancho de la columna de las fases, en caracteres
+const uint8_t ANCHO_NOMBRE_FASE = 18;
+
+// Escribe el nombre de la fase rellenado hasta el ancho de la columna; %-18s cuenta bytes y no caracteres UTF-8
+static void mostrarNombreFase(const char *nombre)
+{
+  uint8_t caracteres = 0;
+  for (const char *c = nombre; *c != '\0'; c++)
+  {
+    if ((*c & 0xC0) != 0x80)
+    {
+      caracteres++;
+    }
+  }
+  Serial.printf("  %s%*s", nombre, caracteres < ANCHO_NOMBRE_FASE ? ANCHO_NOMBRE_FASE - caracteres : 0, "");
+}
+
+void mostrarTraza(const char *nombre, uint32_t mensajes)
+{
+  if (mensajes == 0)
+  {
+    return;
+  }
+  // Juntamos las fases de todos los hilos y descontamos el coste de las sondas
+  uint64_t ciclos[NUM_FASES_TRAZA] = {};
+  uint64_t sondas[NUM_FASES_TRAZA] = {};
+  uint64_t total = 0;
+  uint8_t hilos = hilosTraza.load() < MAX_HILOS_TRAZA ? hilosTraza.load() : MAX_HILOS_TRAZA;
+  for (uint8_t fase = 0; fase < NUM_FASES_TRAZA; fase++)
+  {
+    for (uint8_t i = 0; i < hilos; i++)
+    {
+      ciclos[fase] += estadosTraza[i].ciclos[fase];
+      sondas[fase] += estadosTraza[i].sondas[fase];
+    }
+    uint64_t coste = sondas[fase] * ciclosSonda;
+    ciclos[fase] = ciclos[fase] > coste ? ciclos[fase] - coste : 0;
+    total += ciclos[fase];
+  }
+  double escala = ciclosPorMicrosegundo();
+  Serial.printf("Fases %s, por mensaje:\n", nombre);
+  Serial.printf("  %-18s %8s %14s %12s %7s\n", "Fase", "Sondas", "Ciclos", "us", "%");
+  for (uint8_t fase = 0; fase < NUM_FASES_TRAZA; fase++)
+  {
+    if (sondas[fase] == 0)
+    {
+      continue;
+    }
+    double ciclosMensaje = (double)ciclos[fase] / mensajes;
+    mostrarNombreFase(NOMBRES_FASES[fase]);
+    Serial.printf(" %8.2f %14.0f %12.3f %6.1f%%\n", (double)sondas[fase] / mensajes,
+                  ciclosMensaje, ciclosMensaje / escala, total > 0 ? 100.0 * ciclos[fase] / total : 0.0);
+  }
+  Serial.printf("  %-18s %8s %14.0f %12.3f %6.1f%%\n", "Total", "", (double)total / mensajes, (double)total / mensajes / escala, 100.0);
+}
+#endif
@@ -0,0 +1,173 @@
+// Pruebas de los motores de MAC con los vectores de los RFC (pio test -e native)
+
+#include <unity.h>
+#include <string.h>
+#include "MotorCMAC.h"
+#include "MotorHMAC.h"
+
+// RFC 4493, apartado 4: clave AES-128 y los 64 bytes de mensaje de los que los ejemplos toman 0, 16, 40 y 64
+static const uint8_t claveRFC4493[16] = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+                                         0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+static const uint8_t mensajeRFC4493[64] = {0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+                                           0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+                                           0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+                                           0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10};
+
+static void comprobarCMAC(size_t longitud, const uint8_t *esperado)
+{
+  const ContextoCMAC *contexto = obtenerContextoCMAC(claveRFC4493, 128);
+  TEST_ASSERT_NOT_NULL(contexto);
+  uint8_t mac[LONGITUD_BLOQUE_CMAC];
+  calcularCMAC(contexto, mensajeRFC4493, longitud, mac);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(esperado, mac, LONGITUD_BLOQUE_CMAC);
+}
+
+void test_cmac_subclaves()
+{
+  const uint8_t k1[16] = {0xfb, 0xee, 0xd6, 0x18, 0x35, 0x71, 0x33, 0x66, 0x7c, 0x85, 0xe0, 0x8f, 0x72, 0x36, 0xa8, 0xde};
+  const uint8_t k2[16] = {0xf7, 0xdd, 0xac, 0x30, 0x6a, 0xe2, 0x66, 0xcc, 0xf9, 0x0b, 0xc1, 0x1e, 0xe4, 0x6d, 0x51, 0x3b};
+  const ContextoCMAC *contexto = obtenerContextoCMAC(claveRFC4493, 128);
+  TEST_ASSERT_NOT_NULL(contexto);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(k1, contexto->k1, LONGITUD_BLOQUE_CMAC);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(k2, contexto->k2, LONGITUD_BLOQUE_CMAC);
+}
+
+void test_cmac_ejemplo1_vacio()
+{
+  const uint8_t esperado[16] = {0xbb, 0x1d, 0x69, 0x29, 0xe9, 0x59, 0x37, 0x28, 0x7f, 0xa3, 0x7d, 0x12, 0x9b, 0x75, 0x67, 0x46};
+  comprobarCMAC(0, esperado);
+}
+
+void test_cmac_ejemplo2_16_bytes()
+{
+  const uint8_t esperado[16] = {0x07, 0x0a, 0x16, 0xb4, 0x6b, 0x4d, 0x41, 0x44, 0xf7, 0x9b, 0xdd, 0x9d, 0xd0, 0x4a, 0x28, 0x7c};
+  comprobarCMAC(16, esperado);
+}
+
+void test_cmac_ejemplo3_40_bytes()
+{
+  const uint8_t esperado[16] = {0xdf, 0xa6, 0x67, 0x47, 0xde, 0x9a, 0xe6, 0x30, 0x30, 0xca, 0x32, 0x61, 0x14, 0x97, 0xc8, 0x27};
+  comprobarCMAC(40, esperado);
+}
+
+void test_cmac_ejemplo4_64_bytes()
+{
+  const uint8_t esperado[16] = {0x51, 0xf0, 0xbe, 0xbf, 0x7e, 0x3b, 0x9d, 0x92, 0xfc, 0x49, 0x74, 0x17, 0x79, 0x36, 0x3c, 0xfe};
+  comprobarCMAC(64, esperado);
+}
+
+// RFC 4231 casos 1, 6 y 7 y RFC 2202 caso 1. Cada resumen con cada clave ocupa uno de los
+// MAX_CONTEXTOS_HMAC contextos, así que la clave larga se prueba con SHA-256 (bloque de 64 bytes)
+// y con SHA-384 y SHA-512 (bloque de 128 bytes)
+static const uint8_t claveCorta[20] = {0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b,
+                                       0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b, 0x0b};
+static uint8_t claveLarga[131]; // 131 bytes 0xaa, más larga que el bloque de todas las funciones resumen
+static const char mensajeCaso1[] = "Hi There";
+static const char mensajeCaso6[] = "Test Using Larger Than Block-Size Key - Hash Key First";
+static const char mensajeCaso7[] = "This is a test using a larger than block-size key and a larger than block-size data. "
+                                   "The key needs to be hashed before being used by the HMAC algorithm.";
+
+// Comprueba el MAC con los estados precalculados y con mbedtls cargando la clave en cada mensaje
+static void comprobarHMAC(mbedtls_md_type_t tipo, const uint8_t *clave, uint8_t longitudClave, const char *mensaje,
+                          const uint8_t *esperado, uint8_t longitudEsperado)
+{
+  ContextoHMAC *contexto = obtenerContextoHMAC(tipo, clave, longitudClave);
+  TEST_ASSERT_NOT_NULL(contexto);
+  TEST_ASSERT_EQUAL(longitudEsperado, contexto->longitudResumen);
+  uint8_t mac[MBEDTLS_MD_MAX_SIZE];
+  calcularHMAC(contexto, (const uint8_t *)mensaje, strlen(mensaje), mac);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(esperado, mac, longitudEsperado);
+  memset(mac, 0, sizeof(mac));
+  calcularHMACSinPrecalculo(contexto, (const uint8_t *)mensaje, strlen(mensaje), mac);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(esperado, mac, longitudEsperado);
+}
+
+void test_hmac_sha1_rfc2202_caso1()
+{
+  const uint8_t esperado[20] = {0xb6, 0x17, 0x31, 0x86, 0x55, 0x05, 0x72, 0x64, 0xe2, 0x8b, 0xc0, 0xb6, 0xfb, 0x37, 0x8c, 0x8e,
+                                0xf1, 0x46, 0xbe, 0x00};
+  comprobarHMAC(MBEDTLS_MD_SHA1, claveCorta, sizeof(claveCorta), mensajeCaso1, esperado, sizeof(esperado));
+}
+
+void test_hmac_sha224_caso1()
+{
+  const uint8_t esperado[28] = {0x89, 0x6f, 0xb1, 0x12, 0x8a, 0xbb, 0xdf, 0x19, 0x68, 0x32, 0x10, 0x7c, 0xd4, 0x9d, 0xf3, 0x3f,
+                                0x47, 0xb4, 0xb1, 0x16, 0x99, 0x12, 0xba, 0x4f, 0x53, 0x68, 0x4b, 0x22};
+  comprobarHMAC(MBEDTLS_MD_SHA224, claveCorta, sizeof(claveCorta), mensajeCaso1, esperado, sizeof(esperado));
+}
+
+void test_hmac_sha256_caso1()
+{
+  const uint8_t esperado[32] = {0xb0, 0x34, 0x4c, 0x61, 0xd8, 0xdb, 0x38, 0x53, 0x5c, 0xa8, 0xaf, 0xce, 0xaf, 0x0b, 0xf1, 0x2b,
+                                0x88, 0x1d, 0xc2, 0x00, 0xc9, 0x83, 0x3d, 0xa7, 0x26, 0xe9, 0x37, 0x6c, 0x2e, 0x32, 0xcf, 0xf7};
+  comprobarHMAC(MBEDTLS_MD_SHA256, claveCorta, sizeof(claveCorta), mensajeCaso1, esperado, sizeof(esperado));
+}
+
+void test_hmac_sha384_caso1()
+{
+  const uint8_t esperado[48] = {0xaf, 0xd0, 0x39, 0x44, 0xd8, 0x48, 0x95, 0x62, 0x6b, 0x08, 0x25, 0xf4, 0xab, 0x46, 0x90, 0x7f,
+                                0x15, 0xf9, 0xda, 0xdb, 0xe4, 0x10, 0x1e, 0xc6, 0x82, 0xaa, 0x03, 0x4c, 0x7c, 0xeb, 0xc5, 0x9c,
+                                0xfa, 0xea, 0x9e, 0xa9, 0x07, 0x6e, 0xde, 0x7f, 0x4a, 0xf1, 0x52, 0xe8, 0xb2, 0xfa, 0x9c, 0xb6};
+  comprobarHMAC(MBEDTLS_MD_SHA384, claveCorta, sizeof(claveCorta), mensajeCaso1, esperado, sizeof(esperado));
+}
+
+void test_hmac_sha512_caso1()
+{
+  const uint8_t esperado[64] = {0x87, 0xaa, 0x7c, 0xde, 0xa5, 0xef, 0x61, 0x9d, 0x4f, 0xf0, 0xb4, 0x24, 0x1a, 0x1d, 0x6c, 0xb0,
+                                0x23, 0x79, 0xf4, 0xe2, 0xce, 0x4e, 0xc2, 0x78, 0x7a, 0xd0, 0xb3, 0x05, 0x45, 0xe1, 0x7c, 0xde,
+                                0xda, 0xa8, 0x33, 0xb7, 0xd6, 0xb8, 0xa7, 0x02, 0x03, 0x8b, 0x27, 0x4e, 0xae, 0xa3, 0xf4, 0xe4,
+                                0xbe, 0x9d, 0x91, 0x4e, 0xeb, 0x61, 0xf1, 0x70, 0x2e, 0x69, 0x6c, 0x20, 0x3a, 0x12, 0x68, 0x54};
+  comprobarHMAC(MBEDTLS_MD_SHA512, claveCorta, sizeof(claveCorta), mensajeCaso1, esperado, sizeof(esperado));
+}
+
+void test_hmac_sha256_caso6_clave_larga()
+{
+  const uint8_t esperado[32] = {0x60, 0xe4, 0x31, 0x59, 0x1e, 0xe0, 0xb6, 0x7f, 0x0d, 0x8a, 0x26, 0xaa, 0xcb, 0xf5, 0xb7, 0x7f,
+                                0x8e, 0x0b, 0xc6, 0x21, 0x37, 0x28, 0xc5, 0x14, 0x05, 0x46, 0x04, 0x0f, 0x0e, 0xe3, 0x7f, 0x54};
+  comprobarHMAC(MBEDTLS_MD_SHA256, claveLarga, sizeof(claveLarga), mensajeCaso6, esperado, sizeof(esperado));
+}
+
+void test_hmac_sha384_caso6_clave_larga()
+{
+  const uint8_t esperado[48] = {0x4e, 0xce, 0x08, 0x44, 0x85, 0x81, 0x3e, 0x90, 0x88, 0xd2, 0xc6, 0x3a, 0x04, 0x1b, 0xc5, 0xb4,
+                                0x4f, 0x9e, 0xf1, 0x01, 0x2a, 0x2b, 0x58, 0x8f, 0x3c, 0xd1, 0x1f, 0x05, 0x03, 0x3a, 0xc4, 0xc6,
+                                0x0c, 0x2e, 0xf6, 0xab, 0x40, 0x30, 0xfe, 0x82, 0x96, 0x24, 0x8d, 0xf1, 0x63, 0xf4, 0x49, 0x52};
+  comprobarHMAC(MBEDTLS_MD_SHA384, claveLarga, sizeof(claveLarga), mensajeCaso6, esperado, sizeof(esperado));
+}
+
+void test_hmac_sha512_caso7_clave_y_datos_largos()
+{
+  const uint8_t esperado[64] = {0xe3, 0x7b, 0x6a, 0x77, 0x5d, 0xc8, 0x7d, 0xba, 0xa4, 0xdf, 0xa9, 0xf9, 0x6e, 0x5e, 0x3f, 0xfd,
+                                0xde, 0xbd, 0x71, 0xf8, 0x86, 0x72, 0x89, 0x86, 0x5d, 0xf5, 0xa3, 0x2d, 0x20, 0xcd, 0xc9, 0x44,
+                                0xb6, 0x02, 0x2c, 0xac, 0x3c, 0x49, 0x82, 0xb1, 0x0d, 0x5e, 0xeb, 0x55, 0xc3, 0xe4, 0xde, 0x15,
+                                0x13, 0x46, 0x76, 0xfb, 0x6d, 0xe0, 0x44, 0x60, 0x65, 0xc9, 0x74, 0x40, 0xfa, 0x8c, 0x6a, 0x58};
+  comprobarHMAC(MBEDTLS_MD_SHA512, claveLarga, sizeof(claveLarga), mensajeCaso7, esperado, sizeof(esperado));
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main()
+{
+  memset(claveLarga, 0xaa, sizeof(claveLarga));
+  UNITY_BEGIN();
+  RUN_TEST(test_cmac_subclaves);
+  RUN_TEST(test_cmac_ejemplo1_vacio);
+  RUN_TEST(test_cmac_ejemplo2_16_bytes);
+  RUN_TEST(test_cmac_ejemplo3_40_bytes);
+  RUN_TEST(test_cmac_ejemplo4_64_bytes);
+  RUN_TEST(test_hmac_sha1_rfc2202_caso1);
+  RUN_TEST(test_hmac_sha224_caso1);
+  RUN_TEST(test_hmac_sha256_caso1);
+  RUN_TEST(test_hmac_sha384_caso1);
+  RUN_TEST(test_hmac_sha512_caso1);
+  RUN_TEST(test_hmac_sha256_caso6_clave_larga);
+  RUN_TEST(test_hmac_sha384_caso6_clave_larga);
+  RUN_TEST(test_hmac_sha512_caso7_clave_y_datos_largos);
+  return UNITY_END();
+}